@@ -12,6 +12,8 @@ CFLAGS="$CFLAGS -Wall";
 CFLAGS="$CFLAGS -Wextra";
 CFLAGS="$CFLAGS -Wpedantic";
 
+CFLAGS="$CFLAGS -pthread";
+
 CFLAGS="$CFLAGS -DNDEBUG";
 #CFLAGS="$CFLAGS -gdwarf";
 
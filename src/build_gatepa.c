@@ -35,8 +35,10 @@
 #include "gatepa/alloc.c"
 #include "gatepa/errors.c"
 #include "gatepa/help.c"
+#include "gatepa/journal.c"
 #include "gatepa/open.c"
 #include "gatepa/opts.c"
+#include "gatepa/stats.c"
 #include "gatepa/text.c"
 
 #include "gatepa/apetag/file_check.c"
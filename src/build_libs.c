@@ -13,13 +13,33 @@
 #error "__STDC_VERSION__ < 201112L"
 #endif	/* __STDC_VERSION__ */
 
+#if _POSIX_C_SOURCE < 200809L || !defined(_POSIX_C_SOURCE)
+#undef  _POSIX_C_SOURCE
+#define _POSIX_C_SOURCE		200809L
+#endif	/* _POSIX_C_SOURCE */
+
+/* syscall(), MAP_POPULATE */
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
+#if _FILE_OFFSET_BITS < 64 || !defined(_FILE_OFFSET_BITS)
+#undef  _FILE_OFFSET_BITS
+#define	_FILE_OFFSET_BITS	64
+#endif	/* _FILE_OFFSET_BITS */
+
 /* //////////////////////////////////////////////////////////////////////// */
 
+#include "libs/chump/0-0_init.c"
 #include "libs/chump/1-0_destroy.c"
 #include "libs/chump/1-1_reset.c"
 #include "libs/chump/2-0_alloc.c"
+#include "libs/chump/3-0_mark.c"
+#include "libs/chump/3-1_adopt.c"
+#include "libs/chump/3-2_give.c"
 
 #include "libs/nbufio.c"
+#include "libs/nbufio_ring.c"
 
 #include "libs/gstring/0-0-1_mod_fini.c"
 #include "libs/gstring/0-1-0_ref_bstring.c"
@@ -27,8 +47,11 @@
 #include "libs/gstring/2-0-1_cmp_gstring.c"
 
 #include "libs/gbitset/0-0_init.c"
+#include "libs/bitset/0-0-0_set_0.c"
+#include "libs/bitset/0-0-1_set_1.c"
 #include "libs/bitset/0-1-0_set_range_0.c"
 #include "libs/bitset/0-1-1_set_range_1.c"
+#include "libs/bitset/2-0-0_get.c"
 #include "libs/bitset/2-1-1_find_1.c"
 #include "libs/bitset/3-0-0_popcount.c"
 
@@ -9,8 +9,11 @@
 //                                                                          //
 /////////////////////////////////////////////////////////////////////////// */
 
+#include <inttypes.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
 #include <string.h>
 
 #include <libs/chump.h>
@@ -23,40 +26,109 @@
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+/* the defaults, which gatepa_alloc_config() adjusts from g_alloc */
+
 /* for tag items/values (text strings and binary data) */
 #define CONFIG_A1	CHUMP_CONFIG_STATIC_INIT( \
 	UINT32_C(4096), \
 	UINT32_C(4096), \
 	UINT32_C(  16), \
-	UINT16_C(4096), \
-	UINT16_C(   1) \
+	UINT32_C(4096), \
+	UINT16_C(   1), \
+	UINT16_C(   0) \
 )
 #define CONFIG_A16	CHUMP_CONFIG_STATIC_INIT( \
 	UINT32_C(4096), \
 	UINT32_C(4096), \
 	UINT32_C(  32), \
-	UINT16_C(4096), \
-	UINT16_C(  16) \
+	UINT32_C(4096), \
+	UINT16_C(  16), \
+	UINT16_C(   0) \
 )
 
-/* for tag items/values (text strings and binary data) */
-static struct Chump f_chump_a1	    = CHUMP_STATIC_INIT(CONFIG_A1);
+/* ------------------------------------------------------------------------ */
+
+/* each thread allocates from its own context (set of arenas) */
+struct Alloc_Ctx {
+	/* for tag items/values (text strings and binary data) */
+	struct Chump	a1;
 
-/* for other tag/item stuff */
-static struct Chump f_chump_a16     = CHUMP_STATIC_INIT(CONFIG_A16);
+	/* for other tag/item stuff */
+	struct Chump	a16;
 
-/* for temp data */
-static struct Chump f_chump_scratch = CHUMP_STATIC_INIT(CONFIG_A16);
+	/* for temp data */
+	struct Chump	scratch;
+
+	/* the a1/a16 blocks of the last handoff, which the next rollback
+	     gives back to the worker
+	*/
+	uint32_t	a1_handed;
+	uint32_t	a16_handed;
+};
+
+/*@checkmod@*/
+struct Alloc_Globals g_alloc = {
+	.block_size	= 0,
+	.hugepages	= false
+};
+
+/*@unchecked@*/
+static struct Chump_Config f_config_a1  = CONFIG_A1;
+/*@unchecked@*/
+static struct Chump_Config f_config_a16 = CONFIG_A16;
+
+/* for the main thread */
+static struct Alloc_Ctx f_arenas_main = {
+	CHUMP_STATIC_INIT(CONFIG_A1),
+	CHUMP_STATIC_INIT(CONFIG_A16),
+	CHUMP_STATIC_INIT(CONFIG_A16),
+	0, 0
+};
+
+/* for the worker threads (the data outlives the thread, until handed off) */
+/*@only@*/ /*@null@*/
+static struct Alloc_Ctx *f_arenas_job		= NULL;
+static unsigned int     f_arenas_job_nmemb	= 0;
+
+/* the current thread's context */
+static _Thread_local struct Alloc_Ctx *f_arenas = &f_arenas_main;
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+#undef arenas
+static void arenas_destroy(struct Alloc_Ctx *arenas)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*arenas
+@*/
+;
+
+#undef arenas
+static int arenas_reset(struct Alloc_Ctx *arenas)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*arenas
+@*/
+;
+
+#undef file
+#undef stats
+static void alloc_stats_print_arena(
+	FILE *file, const char *, const struct Chump_Stats *stats
+)
+/*@globals	fileSystem@*/
+/*@modifies	fileSystem,
+		*file
+@*/
+;
+
 /*@temp@*/ /*@null@*/ /*@reldef@*/
 static void *gatepa_calloc_a16(size_t, size_t)
 /*@globals	internalState,
-		f_chump_a16
+		f_arenas
 @*/
 /*@modifies	internalState,
-		f_chump_a16
+		*f_arenas
 @*/
 ;
 
@@ -74,25 +146,309 @@ const struct GString_MyAlloc g_myalloc_gstring = {
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+/* a block is also the big-alloc threshold, so anything that fits in one
+     (say, a cover image under the block size) shares it
+*/
+/* NOTE: call before anything is allocated */
+/* returns 0 on success */
+GATEPA int
+gatepa_alloc_config(void)
+/*@globals	internalState,
+		g_alloc,
+		f_config_a1,
+		f_config_a16,
+		f_arenas_main
+@*/
+/*@modifies	internalState,
+		f_config_a1,
+		f_config_a16,
+		f_arenas_main
+@*/
+{
+	uint32_t block_size  = f_config_a1.block_size;
+	uint32_t block_align = f_config_a1.block_align;
+	uint16_t flags       = 0;
+	int err = 0;
+
+	assert(f_arenas_main.a1.stats.total_allocs  == 0);
+	assert(f_arenas_main.a16.stats.total_allocs == 0);
+
+	if ( g_alloc.block_size != 0 ){
+		block_size = g_alloc.block_size;
+	}
+	if ( g_alloc.hugepages ){
+		block_size  = (block_size > ALLOC_HUGEPAGE_SIZE
+			? block_size : ALLOC_HUGEPAGE_SIZE
+		);
+		block_align = ALLOC_HUGEPAGE_SIZE;
+		flags       = CHUMP_FLAG_HUGEPAGE;
+	}
+
+	f_config_a1.block_size		= block_size;
+	f_config_a1.big_alloc_min	= block_size;
+	f_config_a1.block_align		= block_align;
+	f_config_a1.flags		= flags;
+	f_config_a16.block_size		= block_size;
+	f_config_a16.big_alloc_min	= block_size;
+	f_config_a16.block_align	= block_align;
+	f_config_a16.flags		= flags;
+
+	err |= chump_init(&f_arenas_main.a1, &f_config_a1);
+	err |= chump_init(&f_arenas_main.a16, &f_config_a16);
+	err |= chump_init(&f_arenas_main.scratch, &f_config_a16);
+	return err;
+}
+
 GATEPA void
 gatepa_alloc_destroy(void)
 /*@globals	internalState,
-		f_chump_a1,
-		f_chump_a16,
-		f_chump_scratch
+		f_arenas_main,
+		f_arenas_job,
+		f_arenas_job_nmemb
 @*/
 /*@modifies	internalState,
-		f_chump_a1,
-		f_chump_a16,
-		f_chump_scratch
+		f_arenas_main,
+		f_arenas_job,
+		f_arenas_job_nmemb
 @*/
 {
-	chump_destroy(&f_chump_a1);
-	chump_destroy(&f_chump_a16);
-	chump_destroy(&f_chump_scratch);
+	unsigned int i;
+
+	arenas_destroy(&f_arenas_main);
+	if ( f_arenas_job != NULL ){
+		for ( i = 0; i < f_arenas_job_nmemb; ++i ){
+			arenas_destroy(&f_arenas_job[i]);
+		}
+		free(f_arenas_job);
+		f_arenas_job       = NULL;
+		f_arenas_job_nmemb = 0;
+	}
 	return;
 }
 
+/* marks the main thread's tag arenas, for gatepa_alloc_rollback() */
+/* NOTE: only call from the main thread */
+/* on failure, there is nothing to gatepa_alloc_mark_fini() */
+/* returns 0 on success */
+GATEPA int
+gatepa_alloc_mark(/*@out@*/ struct Alloc_Mark *const mark)
+/*@globals	internalState,
+		f_arenas_main
+@*/
+/*@modifies	internalState,
+		*mark
+@*/
+{
+	int err;
+
+	err = chump_mark(&mark->a1, &f_arenas_main.a1);
+	if ( err != 0 ){
+		/*@-mustdefine@*/
+		return err;
+		/*@=mustdefine@*/
+	}
+	err = chump_mark(&mark->a16, &f_arenas_main.a16);
+	if ( err != 0 ){
+		chump_mark_fini(&mark->a1);
+		return err;
+	}
+	return 0;
+}
+
+GATEPA void
+gatepa_alloc_mark_fini(struct Alloc_Mark *const mark)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*mark
+@*/
+{
+	chump_mark_fini(&mark->a1);
+	chump_mark_fini(&mark->a16);
+	return;
+}
+
+/* frees everything allocated since the mark (and everything in the scratch
+     and worker arenas), but keeps the blocks for re-use; the blocks that
+     the workers handed off are given back to them, so each window re-uses
+     them instead of faulting in new ones
+*/
+/* NOTE: only call from the main thread while no workers are running */
+/* returns 0 on success */
+GATEPA int
+gatepa_alloc_rollback(const struct Alloc_Mark *const mark)
+/*@globals	internalState,
+		f_arenas_main,
+		f_arenas_job,
+		f_arenas_job_nmemb
+@*/
+/*@modifies	internalState,
+		f_arenas_main,
+		f_arenas_job[]
+@*/
+{
+	struct Alloc_Ctx *job;
+	int retval = 0;
+	unsigned int i;
+
+	retval |= chump_rollback(&f_arenas_main.a1, &mark->a1, UINT32_MAX);
+	retval |= chump_rollback(&f_arenas_main.a16, &mark->a16, UINT32_MAX);
+	retval |= chump_reset(&f_arenas_main.scratch, (uint32_t) 1u);
+	if ( f_arenas_job != NULL ){
+		for ( i = 0; i < f_arenas_job_nmemb; ++i ){
+			job     = &f_arenas_job[i];
+			retval |= arenas_reset(job);
+			retval |= chump_give(
+				&job->a1, &f_arenas_main.a1, job->a1_handed
+			);
+			retval |= chump_give(
+				&job->a16, &f_arenas_main.a16, job->a16_handed
+			);
+			job->a1_handed  = 0;
+			job->a16_handed = 0;
+		}
+	}
+	return retval;
+}
+
+static void
+arenas_destroy(struct Alloc_Ctx *const arenas)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*arenas
+@*/
+{
+	chump_destroy(&arenas->a1);
+	chump_destroy(&arenas->a16);
+	chump_destroy(&arenas->scratch);
+	return;
+}
+
+/* returns 0 on success */
+static int
+arenas_reset(struct Alloc_Ctx *const arenas)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*arenas
+@*/
+{
+	int retval = 0;
+
+	retval |= chump_reset(&arenas->a1, UINT32_MAX);
+	retval |= chump_reset(&arenas->a16, UINT32_MAX);
+	retval |= chump_reset(&arenas->scratch, (uint32_t) 1u);
+	return retval;
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* makes sure there are (at least) num_jobs sets of worker arenas */
+/* NOTE: only call from the main thread while no workers are running */
+/* returns 0 on success */
+GATEPA int
+gatepa_alloc_jobs_init(const unsigned int num_jobs)
+/*@globals	internalState,
+		f_config_a1,
+		f_config_a16,
+		f_arenas_job,
+		f_arenas_job_nmemb
+@*/
+/*@modifies	internalState,
+		f_arenas_job,
+		f_arenas_job_nmemb
+@*/
+{
+	struct Alloc_Ctx *arenas;
+	int err = 0;
+	unsigned int i;
+
+	if ( num_jobs <= f_arenas_job_nmemb ){
+		return 0;
+	}
+
+	/* moving an arena does not move its blocks */
+	arenas = realloc(f_arenas_job, num_jobs * sizeof *arenas);
+	if ( arenas == NULL ){
+		return -1;
+	}
+	for ( i = f_arenas_job_nmemb; i < num_jobs; ++i ){
+		err |= chump_init(&arenas[i].a1, &f_config_a1);
+		err |= chump_init(&arenas[i].a16, &f_config_a16);
+		err |= chump_init(&arenas[i].scratch, &f_config_a16);
+		arenas[i].a1_handed  = 0;
+		arenas[i].a16_handed = 0;
+	}
+	f_arenas_job       = arenas;
+	f_arenas_job_nmemb = num_jobs;
+	return err;
+}
+
+/* returns a worker context, which is valid until the next
+     gatepa_alloc_jobs_init()
+*/
+/*@temp@*/
+GATEPA struct Alloc_Ctx *
+gatepa_alloc_ctx_job(const unsigned int job_idx)
+/*@globals	f_arenas_job,
+		f_arenas_job_nmemb
+@*/
+/*@*/
+{
+	assert((f_arenas_job != NULL) && (job_idx < f_arenas_job_nmemb));
+
+	return &f_arenas_job[job_idx];
+}
+
+/* switches the current thread to ctx (NULL is the main thread's) */
+/* returns the previous context */
+/*@temp@*/
+GATEPA struct Alloc_Ctx *
+gatepa_alloc_ctx_select(/*@temp@*/ /*@null@*/ struct Alloc_Ctx *const ctx)
+/*@globals	f_arenas_main@*/
+/*@modifies	f_arenas@*/
+{
+	struct Alloc_Ctx *const prev = f_arenas;
+
+	f_arenas = (ctx != NULL ? ctx : &f_arenas_main);
+	return prev;
+}
+
+/* gives the tag data of a worker context to the main thread's arenas, so it
+     lives (and gets rolled back) with the rest of the window; the worker
+     context is left empty for the next batch of jobs
+*/
+/* NOTE: only call from the main thread after ctx's worker is done */
+/* returns 0 on success, or non-zero with the data still in ctx */
+GATEPA int
+gatepa_alloc_ctx_handoff(struct Alloc_Ctx *const ctx)
+/*@globals	internalState,
+		f_arenas_main
+@*/
+/*@modifies	internalState,
+		f_arenas_main,
+		*ctx
+@*/
+{
+	uint32_t a1_handed, a16_handed;
+	int err;
+
+	assert(ctx != &f_arenas_main);
+
+	a1_handed  = ctx->a1.stats.nmemb_open + ctx->a1.stats.nmemb_full;
+	a16_handed = ctx->a16.stats.nmemb_open + ctx->a16.stats.nmemb_full;
+
+	err = chump_adopt(&f_arenas_main.a1, &ctx->a1);
+	if ( err != 0 ){
+		return err;
+	}
+	ctx->a1_handed += a1_handed;
+	err = chump_adopt(&f_arenas_main.a16, &ctx->a16);
+	if ( err != 0 ){
+		return err;
+	}
+	ctx->a16_handed += a16_handed;
+	return chump_reset(&ctx->scratch, (uint32_t) 1u);
+}
+
 /* ======================================================================== */
 
 /* returns NULL on failure */
@@ -100,17 +456,17 @@ gatepa_alloc_destroy(void)
 GATEPA void *
 gatepa_alloc_a1(const size_t size, const size_t nmemb)
 /*@globals	internalState,
-		f_chump_a1
+		f_arenas
 @*/
 /*@modifies	internalState,
-		f_chump_a1
+		*f_arenas
 @*/
 {
 	if ( (size > UINT32_MAX) || (nmemb > UINT32_MAX) ){
 		return NULL;
 	}
 
-	return chump_alloc(&f_chump_a1, (uint32_t) size, (uint32_t) nmemb);
+	return chump_alloc(&f_arenas->a1, (uint32_t) size, (uint32_t) nmemb);
 }
 
 /* returns NULL on failure */
@@ -118,17 +474,17 @@ gatepa_alloc_a1(const size_t size, const size_t nmemb)
 GATEPA void *
 gatepa_alloc_a1_gstring(const size_t size)
 /*@globals	internalState,
-		f_chump_a1
+		f_arenas
 @*/
 /*@modifies	internalState,
-		f_chump_a1
+		*f_arenas
 @*/
 {
 	if ( size > UINT32_MAX ){
 		return NULL;
 	}
 
-	return chump_alloc(&f_chump_a1, (uint32_t) size, (uint32_t) 1u);
+	return chump_alloc(&f_arenas->a1, (uint32_t) size, (uint32_t) 1u);
 }
 
 /* returns NULL on failure */
@@ -136,17 +492,17 @@ gatepa_alloc_a1_gstring(const size_t size)
 GATEPA void *
 gatepa_alloc_a16(const size_t size, const size_t nmemb)
 /*@globals	internalState,
-		f_chump_a16
+		f_arenas
 @*/
 /*@modifies	internalState,
-		f_chump_a16
+		*f_arenas
 @*/
 {
 	if ( (size > UINT32_MAX) || (nmemb > UINT32_MAX) ){
 		return NULL;
 	}
 
-	return chump_alloc(&f_chump_a16, (uint32_t) size, (uint32_t) nmemb);
+	return chump_alloc(&f_arenas->a16, (uint32_t) size, (uint32_t) nmemb);
 }
 
 /* returns NULL on failure */
@@ -154,10 +510,10 @@ gatepa_alloc_a16(const size_t size, const size_t nmemb)
 static void *
 gatepa_calloc_a16(const size_t size, const size_t nmemb)
 /*@globals	internalState,
-		f_chump_a16
+		f_arenas
 @*/
 /*@modifies	internalState,
-		f_chump_a16
+		*f_arenas
 @*/
 {
 	void *retval;
@@ -166,7 +522,7 @@ gatepa_calloc_a16(const size_t size, const size_t nmemb)
 		return NULL;
 	}
 
-	retval = chump_alloc(&f_chump_a16, (uint32_t) size, (uint32_t) nmemb);
+	retval = chump_alloc(&f_arenas->a16, (uint32_t) size, (uint32_t) nmemb);
 	if ( retval == NULL ){
 		return NULL;
 	}
@@ -184,10 +540,10 @@ gatepa_realloc_a16(
 	const size_t size, const size_t nmemb_old, const size_t nmemb_new
 )
 /*@globals	internalState,
-		f_chump_a16
+		f_arenas
 @*/
 /*@modifies	internalState,
-		f_chump_a16
+		*f_arenas
 @*/
 {
 	void *ptr_new;
@@ -201,7 +557,7 @@ gatepa_realloc_a16(
 		return NULL;
 	}
 
-	ptr_new = chump_alloc(&f_chump_a16, size, nmemb_new);
+	ptr_new = chump_alloc(&f_arenas->a16, size, nmemb_new);
 	if ( (ptr_new != NULL) && (ptr_old != NULL) && (size_old != 0) ){
 		return memcpy(ptr_new, ptr_old, size_old);
 	}
@@ -213,10 +569,10 @@ gatepa_realloc_a16(
 GATEPA void *
 gatepa_alloc_scratch(const size_t size, const size_t nmemb)
 /*@globals	internalState,
-		f_chump_scratch
+		f_arenas
 @*/
 /*@modifies	internalState,
-		f_chump_scratch
+		*f_arenas
 @*/
 {
 	if ( (size > UINT32_MAX) || (nmemb > UINT32_MAX) ){
@@ -224,7 +580,7 @@ gatepa_alloc_scratch(const size_t size, const size_t nmemb)
 	}
 
 	return chump_alloc(
-		&f_chump_scratch, (uint32_t) size, (uint32_t) nmemb
+		&f_arenas->scratch, (uint32_t) size, (uint32_t) nmemb
 	);
 }
 
@@ -232,13 +588,90 @@ gatepa_alloc_scratch(const size_t size, const size_t nmemb)
 GATEPA int
 gatepa_alloc_scratch_reset(void)
 /*@globals	internalState,
-		f_chump_scratch
+		f_arenas
 @*/
 /*@modifies	internalState,
-		f_chump_scratch
+		*f_arenas
+@*/
+{
+	return chump_reset(&f_arenas->scratch, (uint32_t) 1u);
+}
+
+/* ======================================================================== */
+
+/* prints each of the main thread's arenas, then the worker arenas summed */
+COLD
+GATEPA void
+gatepa_alloc_stats_print(FILE *const file)
+/*@globals	fileSystem,
+		f_arenas_main,
+		f_arenas_job,
+		f_arenas_job_nmemb
+@*/
+/*@modifies	fileSystem,
+		*file
+@*/
+{
+	/*@observer@*/
+	static const char *const name[2u][3u] = {
+		{"a1", "a16", "scratch"},
+		{"jobs/a1", "jobs/a16", "jobs/scratch"}
+	};
+	struct Chump_Stats sum;
+	const struct Chump *chump[3u];
+	unsigned int i, j;
+
+	(void) fprintf(file, "%-16s %10s %14s %14s %14s %10s %14s\n",
+		"arena", "allocs", "asked", "given", "waste", "big", "peak"
+	);
+
+	chump[0u] = &f_arenas_main.a1;
+	chump[1u] = &f_arenas_main.a16;
+	chump[2u] = &f_arenas_main.scratch;
+	for ( i = 0; i < 3u; ++i ){
+		alloc_stats_print_arena(file, name[0u][i], &chump[i]->stats);
+	}
+
+	if ( f_arenas_job == NULL ){
+		return;
+	}
+	for ( i = 0; i < 3u; ++i ){
+		(void) memset(&sum, 0x00, sizeof sum);
+		for ( j = 0; j < f_arenas_job_nmemb; ++j ){
+			chump[0u] = &f_arenas_job[j].a1;
+			chump[1u] = &f_arenas_job[j].a16;
+			chump[2u] = &f_arenas_job[j].scratch;
+			sum.total_asked  += chump[i]->stats.total_asked;
+			sum.total_given  += chump[i]->stats.total_given;
+			sum.total_waste  += chump[i]->stats.total_waste;
+			sum.total_peak   += chump[i]->stats.total_peak;
+			sum.total_allocs += chump[i]->stats.total_allocs;
+			sum.total_big    += chump[i]->stats.total_big;
+		}
+		alloc_stats_print_arena(file, name[1u][i], &sum);
+	}
+	return;
+}
+
+/* bytes given but not asked for are alignment padding */
+static void
+alloc_stats_print_arena(
+	FILE *const file, const char *const name,
+	const struct Chump_Stats *const stats
+)
+/*@globals	fileSystem@*/
+/*@modifies	fileSystem,
+		*file
 @*/
 {
-	return chump_reset(&f_chump_scratch, (uint32_t) 1u);
+	(void) fprintf(file,
+		"%-16s %10"PRIu32" %14"PRIu64" %14"PRIu64" %14"PRIu64
+		" %10"PRIu32" %14"PRIu64"\n",
+		name, stats->total_allocs, stats->total_asked,
+		stats->total_given, stats->total_waste, stats->total_big,
+		stats->total_peak
+	);
+	return;
 }
 
 /* EOF //////////////////////////////////////////////////////////////////// */
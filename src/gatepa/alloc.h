@@ -11,9 +11,12 @@
 //                                                                          //
 /////////////////////////////////////////////////////////////////////////// */
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
+#include <stdio.h>
 
+#include <libs/chump.h>
 #include <libs/gbitset.h>
 #include <libs/gstring.h>
 
@@ -21,6 +24,30 @@
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+/* the arena geometry, applied by gatepa_alloc_config() */
+struct Alloc_Globals {
+	uint32_t	block_size;	/* 0 is the default (4 KiB)         */
+	bool		hugepages;	/* 2 MiB blocks, madvise()'d        */
+};
+
+#define ALLOC_BLOCK_SIZE_MIN	UINT32_C(0x00001000)	/* 4 KiB */
+#define ALLOC_BLOCK_SIZE_MAX	UINT32_C(0x40000000)	/* 1 GiB */
+#define ALLOC_HUGEPAGE_SIZE	UINT32_C(0x00200000)	/* 2 MiB */
+
+/*@checkmod@*/ /*@unused@*/
+extern struct Alloc_Globals g_alloc;
+
+/* a thread's set of arenas; the allocs below use the current thread's */
+struct Alloc_Ctx;
+
+/* a checkpoint of the main thread's tag arenas (a1 and a16) */
+struct Alloc_Mark {
+	struct Chump_Mark	a1;
+	struct Chump_Mark	a16;
+};
+
+/* ------------------------------------------------------------------------ */
+
 /*@unchecked@*/ /*@unused@*/
 extern const struct GBitset_MyAlloc g_myalloc_gbitset;
 
@@ -29,11 +56,68 @@ extern const struct GString_MyAlloc g_myalloc_gstring;
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+GATEPA_EXTERN int gatepa_alloc_config(void)
+/*@globals	internalState,
+		g_alloc
+@*/
+/*@modifies	internalState@*/
+;
+
 GATEPA_EXTERN void gatepa_alloc_destroy(void)
 /*@globals	internalState@*/
 /*@modifies	internalState@*/
 ;
 
+#undef mark
+GATEPA_EXTERN int gatepa_alloc_mark(/*@out@*/ struct Alloc_Mark *mark)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*mark
+@*/
+;
+
+#undef mark
+GATEPA_EXTERN void gatepa_alloc_mark_fini(struct Alloc_Mark *mark)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*mark
+@*/
+;
+
+#undef mark
+GATEPA_EXTERN int gatepa_alloc_rollback(const struct Alloc_Mark *mark)
+/*@globals	internalState@*/
+/*@modifies	internalState@*/
+;
+
+GATEPA_EXTERN int gatepa_alloc_jobs_init(unsigned int)
+/*@globals	internalState@*/
+/*@modifies	internalState@*/
+;
+
+/*@temp@*/
+GATEPA_EXTERN struct Alloc_Ctx *gatepa_alloc_ctx_job(unsigned int)
+/*@globals	internalState@*/
+/*@*/
+;
+
+#undef ctx
+/*@temp@*/
+GATEPA_EXTERN struct Alloc_Ctx *gatepa_alloc_ctx_select(
+	/*@temp@*/ /*@null@*/ struct Alloc_Ctx *ctx
+)
+/*@globals	internalState@*/
+/*@modifies	internalState@*/
+;
+
+#undef ctx
+GATEPA_EXTERN int gatepa_alloc_ctx_handoff(struct Alloc_Ctx *ctx)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*ctx
+@*/
+;
+
 /*@temp@*/ /*@null@*/ /*@reldef@*/
 GATEPA_EXTERN void *gatepa_alloc_a1(size_t, size_t)
 /*@globals	internalState@*/
@@ -76,5 +160,16 @@ GATEPA_EXTERN int gatepa_alloc_scratch_reset(void)
 /*@modifies	internalState@*/
 ;
 
+/* ------------------------------------------------------------------------ */
+
+#undef file
+COLD
+GATEPA_EXTERN void gatepa_alloc_stats_print(FILE *file)
+/*@globals	fileSystem@*/
+/*@modifies	fileSystem,
+		*file
+@*/
+;
+
 /* EOF //////////////////////////////////////////////////////////////////// */
 #endif	/* GATEPA_ALLOC_H */
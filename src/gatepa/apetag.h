@@ -11,6 +11,7 @@
 //                                                                          //
 /////////////////////////////////////////////////////////////////////////// */
 
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <stdio.h>
@@ -25,12 +26,24 @@
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+/* when the write modes flush the files they wrote */
+enum Write_Sync {
+	WRITESYNC_NONE,		/* leave it to the kernel           */
+	WRITESYNC_BATCH,	/* once, after each write mode      */
+	WRITESYNC_FILE		/* after each file                  */
+};
+
 struct ApeTag_Globals {
 	uint32_t	items_size_softlimit;
 	uint32_t	key_size_softlimit;
 
 	uint32_t	binary_name_limit;
 	uint32_t	binary_fext_limit;
+
+	uint32_t	pad_size;	/* (write) reserved bytes           */
+	uint32_t	pad_percent;	/* (write) reserved % of the tag    */
+
+	enum Write_Sync	sync;		/* (write) flush policy             */
 };
 
 /*@checkmod@*/ /*@unused@*/
@@ -44,6 +57,13 @@ extern struct ApeTag_Globals g_apetag;
 	ASCII_PERIOD, ASCII_B_LO, ASCII_I_LO, ASCII_N_LO \
 }
 
+/* a zero-filled binary item that reserves room for the tag to grow in
+     place; other readers can ignore it, and it is dropped when slurped
+*/
+#define GATEPA_PADDING_KEY	u8"gatepa-padding"
+#define GATEPA_PADDING_MIN	\
+	(sizeof(struct ApeTag_ItemH) + sizeof GATEPA_PADDING_KEY)
+
 /* //////////////////////////////////////////////////////////////////////// */
 
 /* file structs */
@@ -146,13 +166,35 @@ struct Gatepa_Item {
 	enum ApeFlag_ItemType	type;
 };
 
+/* a key and its case-folding (see apetag/memtag.c); a mode makes one per
+     key argument and uses it for every tag, rather than re-folding the key
+     per file
+*/
+struct Gatepa_Key {
+	struct GString		str;
+	uint64_t		fold;
+	uint32_t		hash;
+};
+
+/* each key is case-folded once when it is added (see apetag/memtag.c), and
+     tags with many items also get a hash index of their keys, which
+     apetag_memtag_find_item() probes instead of scanning every key;
+     .index is NULL until then
+*/
 struct Gatepa_Tag {
 	/*@temp@*/ /*@relnull@*/ /*@reldef@*/
 	struct GString		*key;
 	/*@temp@*/ /*@relnull@*/ /*@reldef@*/
 	struct Gatepa_Item	*item;
+	/*@temp@*/ /*@relnull@*/ /*@reldef@*/
+	uint64_t		*fold;		/* key prefix, parallel     */
+	/*@temp@*/ /*@relnull@*/ /*@reldef@*/
+	uint32_t		*hash;		/* key hash, parallel       */
+	/*@temp@*/ /*@null@*/ /*@reldef@*/
+	uint32_t		*index;		/* .key idx + 1u, 0 is free */
 	uint32_t		nmemb;
 	uint32_t		nmemb_max;
+	uint32_t		index_mask;	/* index nmemb - 1u         */
 	/* size is calculated/checked before writing */
 };
 
@@ -162,12 +204,13 @@ struct Gatepa_FileInfo {
 	off_t			off_begin;
 	off_t			off_end;
 	off_t			off_items;
+	bool			canonical;	/* as write/ would frame it */
 };
 
 /* ------------------------------------------------------------------------ */
 
 #define GATEPA_MEMTAG_INIT		(struct Gatepa_Tag) { \
-	NULL, NULL, 0, 0 \
+	NULL, NULL, NULL, NULL, NULL, 0, 0, 0 \
 }
 
 CONST
@@ -187,12 +230,14 @@ CONST
 ALWAYS_INLINE struct Gatepa_FileInfo
 gatepa_fileinfo_make(
 	const uint32_t items_size, const uint32_t items_nmemb,
-	const off_t off_begin, const off_t off_end, const off_t off_items
+	const off_t off_begin, const off_t off_end, const off_t off_items,
+	const bool canonical
 )
 /*@*/
 {
 	return (struct Gatepa_FileInfo) {
-		items_size, items_nmemb, off_begin, off_end, off_items
+		items_size, items_nmemb, off_begin, off_end, off_items,
+		canonical
 	};
 }
 
@@ -208,6 +253,18 @@ enum Sort_TagCompar {
 	TAGCOMPAR_ALPHA
 };
 
+/* what sorting compares items by, gathered once per tag into dense columns
+     (instead of re-deriving it from each item in every comparison)
+*/
+struct Sort_Columns {
+	/*@temp@*/
+	const struct Gatepa_Tag	*tag;
+	/*@temp@*/
+	int8_t			*score;		/* item order class         */
+	/*@temp@*/
+	uint32_t		*size;		/* value size, if compared  */
+};
+
 enum Write_TagType {
 	TAGTYPE_LONG,
 	TAGTYPE_SHORT
@@ -216,29 +273,31 @@ enum Write_TagType {
 /* //////////////////////////////////////////////////////////////////////// */
 
 #undef fileinfo
-#undef file
-GATEPA_EXTERN enum TagCheckError apetag_file_tag_check_eof(
-	/*@out@*/ struct Gatepa_FileInfo *fileinfo, nbufio_fd file
+GATEPA_EXTERN enum TagCheckError apetag_tag_check_footer(
+	/*@out@*/ struct Gatepa_FileInfo *fileinfo,
+	const struct ApeTag_TagHF *, off_t
 )
-/*@globals	fileSystem,
-		internalState
-@*/
-/*@modifies	internalState,
-		*fileinfo
-@*/
+/*@modifies	*fileinfo@*/
+;
+
+#undef fileinfo
+GATEPA_EXTERN enum TagCheckError apetag_tag_check_header(
+	struct Gatepa_FileInfo *fileinfo,
+	const struct ApeTag_TagHF *, const struct ApeTag_TagHF *
+)
+/*@modifies	*fileinfo@*/
 ;
 
 #undef tag_out
-#undef file
-GATEPA_EXTERN enum SlurpError apetag_slurp_tag(
+#undef file_info
+GATEPA_EXTERN enum SlurpError apetag_slurp_tag_blob(
 	/*@out@*/ struct Gatepa_Tag *tag_out,
-	const struct Gatepa_FileInfo *, nbufio_fd file
+	struct Gatepa_FileInfo *file_info, /*@dependent@*/ const uint8_t *
 )
-/*@globals	fileSystem,
-		internalState
-@*/
+/*@globals	internalState@*/
 /*@modifies	internalState,
-		*tag_out
+		*tag_out,
+		file_info->canonical
 @*/
 ;
 
@@ -251,38 +310,58 @@ GATEPA_EXTERN enum GatepaErr apetag_size_items(
 /*@modifies	*size_out@*/
 ;
 
-GATEPA_EXTERN enum GatepaErr apetag_write_tag_header(
-	nbufio_fd, uint32_t, uint32_t
+#undef buf
+GATEPA_EXTERN size_t apetag_construct_tag_header(
+	/*@out@*/ uint8_t *buf, uint32_t, uint32_t
 )
-/*@globals	fileSystem,
-		internalState
-@*/
-/*@modifies	fileSystem,
-		internalState
-@*/
+/*@modifies	*buf@*/
 ;
 
 #undef buf
 GATEPA_EXTERN size_t apetag_construct_tag(
 	/*@out@*/ uint8_t *buf, size_t, const struct Gatepa_Tag *,
-	enum Write_TagType
+	enum Write_TagType, size_t
 )
 /*@modifies	*buf@*/
 ;
 
 /* ======================================================================== */
 
+#undef memkey
+GATEPA_EXTERN void apetag_memkey_make(
+	/*@out@*/ struct Gatepa_Key *memkey, const struct GString *
+)
+/*@modifies	*memkey@*/
+;
+
 NOINLINE PURE
 GATEPA_EXTERN uint32_t apetag_memtag_find_item(
-	const struct Gatepa_Tag *, const struct GString *
+	const struct Gatepa_Tag *, const struct Gatepa_Key *
 )
 /*@*/
 ;
 
+PURE
+GATEPA_EXTERN int apetag_memtag_cmp_key(
+	const struct Gatepa_Tag *, uint32_t, uint32_t
+)
+/*@*/
+;
+
+#undef tag
+GATEPA_EXTERN enum GatepaErr apetag_memtag_reserve(
+	struct Gatepa_Tag *tag, uint32_t
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*tag
+@*/
+;
+
 #undef tag
 NOINLINE
 GATEPA_EXTERN enum GatepaErr apetag_memtag_add_item(
-	struct Gatepa_Tag *tag, const struct GString *,
+	struct Gatepa_Tag *tag, const struct Gatepa_Key *,
 	const struct Gatepa_Item *
 )
 /*@globals	internalState@*/
@@ -293,9 +372,9 @@ GATEPA_EXTERN enum GatepaErr apetag_memtag_add_item(
 
 #undef tag
 GATEPA_EXTERN void apetag_memtag_rename_item(
-	struct Gatepa_Tag *tag, uint32_t, const struct GString *
+	struct Gatepa_Tag *tag, uint32_t, const struct Gatepa_Key *
 )
-/*@modifies	tag->key[]@*/
+/*@modifies	*tag@*/
 ;
 
 #undef tag
@@ -318,6 +397,11 @@ GATEPA_EXTERN enum GatepaErr apetag_memtag_remove_item(
 /*@modifies	*tag@*/
 ;
 
+#undef tag
+GATEPA_EXTERN void apetag_memtag_reindex(struct Gatepa_Tag *tag)
+/*@modifies	*tag@*/
+;
+
 /* ------------------------------------------------------------------------ */
 
 #undef item
@@ -332,7 +416,18 @@ GATEPA_EXTERN enum GatepaErr apetag_memitem_add_value(
 ;
 
 #undef item
-GATEPA_EXTERN void
+/*@temp@*/ /*@null@*/ /*@reldef@*/
+GATEPA_EXTERN struct GString *apetag_memitem_multi_init(
+	struct Gatepa_Item *item, uint32_t
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*item
+@*/
+;
+
+#undef item
+GATEPA_EXTERN bool
 apetag_memitem_replace_value(
 	struct Gatepa_Item *item, const struct GString *,
 	enum ApeFlag_ItemType
@@ -360,13 +455,17 @@ GATEPA_EXTERN void gatepa_print_long(FILE *file, const struct Gatepa_Tag *)
 
 /* ======================================================================== */
 
-PURE
-GATEPA_EXTERN int apetag_compar_audio(const void *, const void *, void *)
-/*@*/
+#undef columns
+GATEPA_EXTERN void apetag_sort_columns(
+	struct Sort_Columns *columns, enum Sort_TagCompar
+)
+/*@modifies	columns->score[],
+		columns->size[]
+@*/
 ;
 
 PURE
-GATEPA_EXTERN int apetag_compar_alpha(const void *, const void *, void *)
+GATEPA_EXTERN int apetag_compar_columns(const void *, const void *, void *)
 /*@*/
 ;
 
@@ -10,6 +10,7 @@
 /////////////////////////////////////////////////////////////////////////// */
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <stdint.h>
 #include <string.h>
@@ -55,121 +56,100 @@ static enum TagCheckError qverify_err(unsigned int) /*@*/;
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+/* checks a footer read from the end of the file (off_end), without i/o */
+/* on success, off_begin is the start of the items, until a header is found
+     by apetag_tag_check_header()
+*/
 /* returns 0 on success */
 GATEPA enum TagCheckError
-apetag_file_tag_check_eof(
-	/*@out@*/ struct Gatepa_FileInfo *const fileinfo, const nbufio_fd file
+apetag_tag_check_footer(
+	/*@out@*/ struct Gatepa_FileInfo *const fileinfo,
+	const struct ApeTag_TagHF *const footer, const off_t off_end
 )
-/*@globals	fileSystem,
-		internalState
-@*/
-/*@modifies	internalState,
-		*fileinfo
-@*/
+/*@modifies	*fileinfo@*/
 {
-	struct ApeTag_TagHF tag_hf[2u];
-	unsigned int qverify[2u] = {0, 0};
-	enum TagCheckError retval = 0;
-	uint32_t items_size;
-	off_t off_begin, off_end, off_items;
-	off_t seek_offset;
-	union {	size_t	z;
-		off_t	o;
-	} err;
-
-	/* seek/read the footer */
-	err.o = nbufio_seek(
-		file, -((off_t) sizeof(struct ApeTag_TagHF)), SEEK_END
-	);
-	if ( err.o == NBUFIO_OFF_ERROR ){
-		/*@-mustdefine@*/
-		return TAGCHECK_ERR_SEEK;
-		/*@=mustdefine@*/
-	}
-	/* * */
-	err.z = nbufio_read(file, &tag_hf[0u], sizeof tag_hf[0u]);
-	if ( err.z != sizeof tag_hf[0u] ){
-		/*@-mustdefine@*/
-		return (err.z != NBUFIO_RW_ERROR
-			? TAGCHECK_ERR_READ_EOF : TAGCHECK_ERR_READ
-		);
-		/*@=mustdefine@*/
-	}
-	off_end = nbufio_tell(file);
-	if ( off_end == NBUFIO_OFF_ERROR ){
-		/*@-mustdefine@*/
-		return TAGCHECK_ERR_SEEK;
-		/*@=mustdefine@*/
-	}
+	unsigned int qverify;
+	struct ApeTag_TagHF canon;
+	uint32_t items_size, nmemb;
+	off_t off_items;
 
-	/* check if we read an APETAGEX footer */
-	qverify[0u] = apetag_file_tag_hf_qverify(
-		&tag_hf[0u], APETAG_TAG_FOOTER
-	);
-	if ( qverify[0u] != 0 ){
+	qverify = apetag_file_tag_hf_qverify(footer, APETAG_TAG_FOOTER);
+	if ( qverify != 0 ){
 		*fileinfo  = gatepa_fileinfo_make(
-			0, 0, off_end, NBUFIO_OFF_ERROR, NBUFIO_OFF_ERROR
+			0, 0, off_end, NBUFIO_OFF_ERROR, NBUFIO_OFF_ERROR,
+			false
 		);
-		return qverify_err(qverify[0u]);
+		return qverify_err(qverify);
 	}
 
-	/* seek/read to check for the optional header */
-	seek_offset  = (off_t) byteswap_u32_letoh(tag_hf[0u].size);
-	if ( seek_offset <= (off_t) sizeof(struct ApeTag_TagHF) ){
-		/* MAYBE: error here */
-		off_begin  = off_end - ((off_t) sizeof(struct ApeTag_TagHF));
-		off_items  = off_begin;
-		goto fn_end;
-	}
-	seek_offset += ((off_t) sizeof(struct ApeTag_TagHF));
-	err.o = nbufio_seek(file, -seek_offset, SEEK_CUR);
-	if ( err.o == NBUFIO_OFF_ERROR ){
-		/*@-mustdefine@*/
-		return TAGCHECK_ERR_SEEK;
-		/*@=mustdefine@*/
-	}
+	items_size = byteswap_u32_letoh(footer->size);
+	nmemb      = byteswap_u32_letoh(footer->nmemb);
+	/* MAYBE: error if the size is too small */
+	off_items  = off_end - (items_size > (uint32_t) sizeof *footer
+		? (off_t) items_size : (off_t) sizeof *footer
+	);
+
+	/* whether write/ would write the very same footer */
+	canon      = apetag_taghf_make(
+		items_size, nmemb, APEFLAG_NO_READONLY,
+		APEFLAG_IS_FOOTER | APEFLAG_HAS_FOOTER
+		| (footer->is_headfoot & APEFLAG_HAS_HEADER)
+	);
+	*fileinfo  = gatepa_fileinfo_make(
+		items_size, nmemb, off_items, off_end, off_items,
+		memcmp(footer, &canon, sizeof canon) == 0
+	);
+	return 0;
+}
+
+/* checks the optional header, read from just before fileinfo->off_items */
+/* returns 0 on success */
+GATEPA enum TagCheckError
+apetag_tag_check_header(
+	struct Gatepa_FileInfo *const fileinfo,
+	const struct ApeTag_TagHF *const footer,
+	const struct ApeTag_TagHF *const header
+)
+/*@modifies	*fileinfo@*/
+{
+	const bool has_header = (footer->is_headfoot & APEFLAG_HAS_HEADER) != 0;
 	/* * */
-	err.z = nbufio_read(file, &tag_hf[1u], sizeof tag_hf[1u]);
-	if ( err.z != sizeof tag_hf[1u] ){
-		/*@-mustdefine@*/
-		return (err.z != NBUFIO_RW_ERROR
-			? TAGCHECK_ERR_READ_EOF : TAGCHECK_ERR_READ
-		);
-		/*@=mustdefine@*/
-	}
-	off_begin = off_end - ((off_t) byteswap_u32_letoh(tag_hf[0u].size));
-	off_items = off_begin;
+	enum TagCheckError retval = 0;
+	struct ApeTag_TagHF canon;
+	unsigned int qverify;
 
 	/* check if we read an APETAGEX header */
-	qverify[1u] = apetag_file_tag_hf_qverify(
-		&tag_hf[1u], APETAG_TAG_HEADER
-	);
-	if ( qverify[1u] == 0 ){
-		if ( (tag_hf[0u].size  != tag_hf[1u].size)
-		    ||
-		     (tag_hf[0u].nmemb != tag_hf[1u].nmemb)
-		){
-			retval = TAGCHECK_ERR_MISMATCHED;
+	qverify = apetag_file_tag_hf_qverify(header, APETAG_TAG_HEADER);
+	if ( qverify != 0 ){
+		if ( has_header ){
+			fileinfo->canonical = false;
 		}
-		off_begin -= (off_t) sizeof(struct ApeTag_TagHF);
+		return 0;	/* MAYBE */
 	}
 
-fn_end:
-	if ( qverify[0u] != 0 ){
-		; /* MAYBE */
-	}
-	if ( qverify[1u] != 0 ){
-		; /* MAYBE */
+	if ( (footer->size  != header->size)
+	    ||
+	     (footer->nmemb != header->nmemb)
+	){
+		retval = TAGCHECK_ERR_MISMATCHED;
 	}
+	fileinfo->off_begin -= (off_t) sizeof *header;
 
-	items_size = byteswap_u32_letoh(tag_hf[0u].size);
-	*fileinfo  = gatepa_fileinfo_make(
-		items_size, byteswap_u32_letoh(tag_hf[0u].nmemb),
-		off_begin, off_end, off_items
+	/* whether write/ would write the very same header */
+	canon = apetag_taghf_make(
+		fileinfo->items_size, fileinfo->items_nmemb,
+		APEFLAG_NO_READONLY,
+		APEFLAG_IS_HEADER | APEFLAG_HAS_FOOTER | APEFLAG_HAS_HEADER
 	);
+	if ( !has_header || (memcmp(header, &canon, sizeof canon) != 0) ){
+		fileinfo->canonical = false;
+	}
+
 	return retval;
 }
 
+/* ------------------------------------------------------------------------ */
+
 /* returns 0 on success, or a mask of the errors */
 PURE
 static unsigned int
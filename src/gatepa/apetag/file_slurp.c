@@ -17,9 +17,9 @@
 #include <string.h>
 
 #include <libs/ascii-literals.h>
+#include <libs/bitset.h>
 #include <libs/byteswap.h>
 #include <libs/gstring.h>
-#include <libs/nbufio.h>
 #include <libs/overflow.h>
 
 #include "../alloc.h"
@@ -30,83 +30,133 @@
 
 /* //////////////////////////////////////////////////////////////////////// */
 
-/* opt_g_apetag_strtol() depends on field order */
+/* opt_g_apetag_strtol() and opt_g_apetag_pad() depend on field order */
 /*@checkmod@*/
 struct ApeTag_Globals g_apetag = {
 	.items_size_softlimit	= UINT32_C(1048576),
 	.key_size_softlimit	= UINT32_C(     24),
 
 	.binary_name_limit	= UINT32_C(    256),
-	.binary_fext_limit	= UINT32_C(     32)
+	.binary_fext_limit	= UINT32_C(     32),
+
+	.pad_size		= 0,
+	.pad_percent		= 0,
+
+	.sync			= WRITESYNC_NONE
 };
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+/* blob bytes that the NUL index covers at a time */
+#define NULSCAN_SPAN		((uint32_t) 256u)
+
+/* the NUL bytes of an items blob, indexed as the parser goes:
+     the parser only moves forward, so each span of the blob is swept (a word
+     at a time) into a bitset once, and every key/value end in that span is
+     then found by bit instead of by another memchr()
+*/
+struct Slurp_NulScan {
+	/*@dependent@*/
+	const uint8_t	*blob;
+	uint32_t	size;
+	uint32_t	base;		/* blob offset of the first bit     */
+	uint32_t	bitlen;		/* bits in the current span         */
+	uint8_t		bits[NULSCAN_SPAN / 8u];
+};
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+#undef scan
+static void slurp_nulscan_sweep(struct Slurp_NulScan *scan, uint32_t)
+/*@modifies	*scan@*/
+;
+
+#undef scan
+static uint32_t slurp_nulscan_strlen(
+	struct Slurp_NulScan *scan, const uint8_t *, uint32_t
+)
+/*@modifies	*scan@*/
+;
+
+PURE
+static uint32_t slurp_count_values(const uint8_t *, uint32_t) /*@*/;
+
 #undef tag
 #undef size_read_out
-#undef file
+#undef scan
 static enum SlurpError slurp_item_blob(
 	struct Gatepa_Tag *tag, /*@out@*/ uint32_t *size_read_out,
-	const uint8_t *, uint32_t, uint32_t, enum ApeFlag_ItemType, uint32_t
+	struct Slurp_NulScan *scan, const uint8_t *, uint32_t, uint32_t,
+	enum ApeFlag_ItemType, uint32_t
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
 		*size_read_out,
-		*tag
+		*tag,
+		*scan
 @*/
 ;
 
 #undef gs
 #undef size_read_out
+#undef scan
 static enum SlurpError slurp_item_key(
 	/*@out@*/ struct GString *gs, /*@out@*/ uint32_t *size_read_out,
-	const uint8_t *, uint32_t, uint32_t
+	struct Slurp_NulScan *scan, const uint8_t *, uint32_t, uint32_t
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
 		*gs,
-		*size_read_out
+		*size_read_out,
+		*scan
 @*/
 ;
 
 #undef item
 #undef size_read_out
+#undef scan
 static enum SlurpError slurp_item_value(
 	/*@in@*/ struct Gatepa_Item *item,
-	/*@out@*/ uint32_t *size_read_out, const uint8_t *, uint32_t,
-	enum ApeFlag_ItemType
+	/*@out@*/ uint32_t *size_read_out, struct Slurp_NulScan *scan,
+	const uint8_t *, uint32_t, enum ApeFlag_ItemType
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
 		*item,
-		*size_read_out
+		*size_read_out,
+		*scan
 @*/
 ;
 
 #undef item
 #undef size_read_out
+#undef scan
 static enum SlurpError slurp_item_value_text(
 	/*@in@*/ struct Gatepa_Item *item,
-	/*@out@*/ uint32_t *size_read_out, const uint8_t *, uint32_t,
-	enum ApeFlag_ItemType
+	/*@out@*/ uint32_t *size_read_out, struct Slurp_NulScan *scan,
+	const uint8_t *, uint32_t, enum ApeFlag_ItemType
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
 		*item,
-		*size_read_out
+		*size_read_out,
+		*scan
 @*/
 ;
 
 #undef item
 #undef size_read_out
+#undef scan
 static enum SlurpError slurp_item_value_binary(
 	/*@in@*/ struct Gatepa_Item *item,
-	/*@out@*/ uint32_t *size_read_out, const uint8_t *, uint32_t
+	/*@out@*/ uint32_t *size_read_out, struct Slurp_NulScan *scan,
+	const uint8_t *, uint32_t
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
 		*item,
-		*size_read_out
+		*size_read_out,
+		*scan
 @*/
 ;
 
@@ -125,57 +175,54 @@ static enum SlurpError slurp_item_value_unknown(
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+/* parses an items blob (items + footer) that was already read in */
+/* the blob must outlive the tag, as the strings reference it */
+/* file_info->canonical is cleared if the items would not be written back
+     byte for byte
+*/
 /* returns 0 on success */
 GATEPA enum SlurpError
-apetag_slurp_tag(
+apetag_slurp_tag_blob(
 	/*@out@*/ struct Gatepa_Tag *const tag_out,
-	const struct Gatepa_FileInfo *const file_info, const nbufio_fd file
+	struct Gatepa_FileInfo *const file_info,
+	/*@dependent@*/ const uint8_t *const blob
 )
-/*@globals	fileSystem,
-		internalState
-@*/
+/*@globals	internalState@*/
 /*@modifies	internalState,
-		*tag_out
+		*tag_out,
+		file_info->canonical
 @*/
 {
 	struct Gatepa_Tag tag = GATEPA_MEMTAG_INIT;
+	struct Slurp_NulScan scan;
 	struct ApeTag_ItemH itemh;
-	uint8_t *blob = NULL;
 	uint32_t blob_idx, new_idx;
-	uint32_t size_read;
-	size_t size_result, temp_size, target_size;
-	uint32_t item_idx;
-	off_t seek_err;
+	uint32_t size_read, size_items;
+	size_t target_size;
+	uint32_t item_idx, nmemb_max;
 	int err;
 
 	assert(file_info->items_size >= sizeof(struct ApeTag_TagHF));
 
-	/* seek to the start of the items blob */
-	seek_err = nbufio_seek(file, file_info->off_items, SEEK_SET);
-	if ( seek_err == NBUFIO_OFF_ERROR ){
+	/* size the tag from the footer, but no bigger than the blob can hold */
+	nmemb_max = (uint32_t) (
+		(file_info->items_size - sizeof(struct ApeTag_TagHF))
+		/ (sizeof itemh + 1u)
+	);
+	err = (int) apetag_memtag_reserve(&tag, (
+		file_info->items_nmemb < nmemb_max
+			? file_info->items_nmemb : nmemb_max
+	));
+	if ( err != 0 ){
 		/*@-mustdefine@*/ /*@-mustmod@*/
-		return SLURP_ERR_SEEK;
+		return SLURP_ERR_MEMTAG;
 		/*@=mustdefine@*/ /*@=mustmod@*/
 	}
 
-	/* read the blob into a buffer */
-
-	blob = gatepa_alloc_a1(file_info->items_size, (size_t) 1u);
-	if ( blob == NULL ){
-		/*@-mustdefine@*/ /*@-mustmod@*/
-		return SLURP_ERR_ALLOCATOR;
-		/*@=mustdefine@*/ /*@=mustmod@*/
-	}
-	assert(blob != NULL);
-	temp_size   = (size_t) file_info->items_size;
-	size_result = nbufio_read(file, blob, temp_size);
-	if ( size_result != temp_size ){
-		/*@-mustdefine@*/ /*@-mustmod@*/
-		return (size_result != NBUFIO_RW_ERROR
-			? SLURP_ERR_READ_EOF : SLURP_ERR_READ_SYS
-		);
-		/*@=mustdefine@*/ /*@=mustmod@*/
-	}
+	scan.blob   = blob;
+	scan.size   = file_info->items_size;
+	scan.base   = 0;
+	scan.bitlen = 0;
 
 	blob_idx = 0;
 	for ( item_idx = 0; item_idx < file_info->items_nmemb; ++item_idx ){
@@ -196,12 +243,20 @@ apetag_slurp_tag(
 		(void) memcpy(&itemh, &blob[blob_idx], sizeof itemh);
 		/* MAYBE: verify item header */
 		itemh.size = byteswap_u32_letoh(itemh.size);
+		if ( (itemh.type != (uint8_t) APETAG_ITEM_TYPE(itemh.type))
+		    ||
+		     (itemh.pad_0[0] != 0) || (itemh.pad_0[1] != 0)
+		    ||
+		     (itemh.pad_0[2] != 0)
+		){
+			file_info->canonical = false;	/* flags dropped */
+		}
 		blob_idx   = new_idx;
 
 		/* item */
 		assert(file_info->items_size > blob_idx);
 		err = slurp_item_blob(
-			&tag, &size_read, &blob[blob_idx],
+			&tag, &size_read, &scan, &blob[blob_idx],
 			file_info->items_size - blob_idx, itemh.size,
 			APETAG_ITEM_TYPE(itemh.type), item_idx
 		);
@@ -230,6 +285,18 @@ apetag_slurp_tag(
 		/*@=mustdefine@*/ /*@=mustmod@*/
 	}
 
+	/* a dropped padding item, or a renamed key/filename, changes the
+	     count or the size of the items
+	*/
+	if ( (tag.nmemb != file_info->items_nmemb)
+	    ||
+	     (apetag_size_items(&size_items, &tag) != 0)
+	    ||
+	     ((size_t) size_items != target_size)
+	){
+		file_info->canonical = false;
+	}
+
 	*tag_out = tag;
 	return 0;
 }
@@ -241,17 +308,22 @@ apetag_slurp_tag(
 static enum SlurpError
 slurp_item_blob(
 	struct Gatepa_Tag *const tag,
-	/*@out@*/ uint32_t *const size_read_out, const uint8_t *const blob,
+	/*@out@*/ uint32_t *const size_read_out,
+	struct Slurp_NulScan *const scan, const uint8_t *const blob,
 	const uint32_t blob_limit, const uint32_t value_size,
 	const enum ApeFlag_ItemType type, const uint32_t item_idx
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
 		*tag,
-		*size_read_out
+		*size_read_out,
+		*scan
 @*/
 {
+	static const uint8_t padding_key[] = GATEPA_PADDING_KEY;
+	/* * */
 	struct GString key;
+	struct Gatepa_Key memkey;
 	struct Gatepa_Item item = gatepa_memitem_init(type);
 	uint32_t size_blob_read = 0, size_blob_left = blob_limit;
 	uint32_t size_read;
@@ -259,7 +331,7 @@ slurp_item_blob(
 
 	/* key */
 	err = slurp_item_key(
-		&key, &size_read, blob, size_blob_left, item_idx
+		&key, &size_read, scan, blob, size_blob_left, item_idx
 	);
 	if ( err != 0 ){
 		/*@-mustdefine@*/ /*@-mustmod@*/
@@ -280,10 +352,22 @@ slurp_item_blob(
 		return SLURP_ERR_TAG_SIZE_MISMATCH;
 		/*@=mustdefine@*/ /*@=mustmod@*/
 	}
+	if ( (type == APEFLAG_ITEMTYPE_BINARY)
+	    &&
+	     (key.len == (uint32_t) sizeof padding_key - 1u)
+	    &&
+	     (memcmp(GSTRING_PTR(&key), padding_key, (size_t) key.len) == 0)
+	){
+		/* drop the padding item, as the writer re-creates it */
+		*size_read_out = size_blob_read + value_size;
+		/*@-mustmod@*/
+		return 0;
+		/*@=mustmod@*/
+	}
 	if ( size_blob_left != 0 ){
 		err = slurp_item_value(
-			&item, &size_read, &blob[size_blob_read], value_size,
-			type
+			&item, &size_read, scan, &blob[size_blob_read],
+			value_size, type
 		);
 		if ( err != 0 ){
 			/*@-mustdefine@*/ /*@-mustmod@*/
@@ -301,7 +385,8 @@ slurp_item_blob(
 	}
 
 	/* add the item to the tag */
-	err = (int) apetag_memtag_add_item(tag, &key, &item);
+	apetag_memkey_make(&memkey, &key);
+	err = (int) apetag_memtag_add_item(tag, &memkey, &item);
 	if ( err != 0 ){
 		/*@-mustdefine@*/ /*@-mustmod@*/
 		return err;
@@ -316,26 +401,23 @@ slurp_item_blob(
 static enum SlurpError
 slurp_item_key(
 	/*@out@*/ struct GString *const gs,
-	/*@out@*/ uint32_t *const size_read_out, const uint8_t *const blob,
+	/*@out@*/ uint32_t *const size_read_out,
+	struct Slurp_NulScan *const scan, const uint8_t *const blob,
 	const uint32_t blob_limit, const uint32_t item_idx
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
 		*gs,
-		*size_read_out
+		*size_read_out,
+		*scan
 @*/
 {
-	const uintptr_t nulbyte = (uintptr_t) memchr(
-		blob, (int) ASCII_NUL, (size_t) blob_limit
-	);
-	uint32_t size = (nulbyte == 0
-		? blob_limit : (uint32_t) (nulbyte - ((uintptr_t) blob))
-	);
+	uint32_t size = slurp_nulscan_strlen(scan, blob, blob_limit);
 	const uint8_t *key = blob;
 	uint8_t buf[32u];
 	int err;
 
-	if ( nulbyte == 0 ){
+	if ( size == blob_limit ){
 		/* give the key a name */
 		err = snprintf(
 			(char *) buf, sizeof buf, u8"key-%"PRIu32, item_idx
@@ -364,24 +446,26 @@ slurp_item_key(
 static enum SlurpError
 slurp_item_value(
 	/*@in@*/ struct Gatepa_Item *const item,
-	/*@out@*/ uint32_t *const size_read_out, const uint8_t *const blob,
+	/*@out@*/ uint32_t *const size_read_out,
+	struct Slurp_NulScan *const scan, const uint8_t *const blob,
 	const uint32_t value_size, const enum ApeFlag_ItemType type
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
 		*item,
-		*size_read_out
+		*size_read_out,
+		*scan
 @*/
 {
 	switch ( type ){
 	case APEFLAG_ITEMTYPE_TEXT:
 	case APEFLAG_ITEMTYPE_LOCATOR:
 		return slurp_item_value_text(
-			item, size_read_out, blob, value_size, type
+			item, size_read_out, scan, blob, value_size, type
 		);
 	case APEFLAG_ITEMTYPE_BINARY:
 		return slurp_item_value_binary(
-			item, size_read_out, blob, value_size
+			item, size_read_out, scan, blob, value_size
 		);
 	case APEFLAG_ITEMTYPE_UNKNOWN:
 	default:
@@ -395,19 +479,24 @@ slurp_item_value(
 static enum SlurpError
 slurp_item_value_text(
 	/*@in@*/ struct Gatepa_Item *const item,
-	/*@out@*/ uint32_t *const size_read_out, const uint8_t *const blob,
+	/*@out@*/ uint32_t *const size_read_out,
+	struct Slurp_NulScan *const scan, const uint8_t *const blob,
 	const uint32_t value_size_total, const enum ApeFlag_ItemType type
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
 		*item,
-		*size_read_out
+		*size_read_out,
+		*scan
 @*/
 {
+	const uint32_t nvalues = slurp_count_values(blob, value_size_total);
+	/* * */
 	struct GString gs;
-	uintptr_t nulbyte;
-	uint32_t value_size;
-	uint32_t size_read = 0;
+	/*@temp@*/ /*@null@*/
+	struct GString *multi = NULL;
+	uint32_t value_size, value_limit;
+	uint32_t size_read = 0, value_idx = 0;
 	int err;
 
 	assert( (type == APEFLAG_ITEMTYPE_TEXT)
@@ -415,15 +504,21 @@ slurp_item_value_text(
 	        (type == APEFLAG_ITEMTYPE_LOCATOR)
 	);
 
+	/* allocate the values array once, instead of value by value */
+	if ( nvalues > (uint32_t) 1u ){
+		multi = apetag_memitem_multi_init(item, nvalues);
+		if ( multi == NULL ){
+			/*@-mustdefine@*/ /*@-mustmod@*/
+			return SLURP_ERR_MEMTAG;
+			/*@=mustdefine@*/ /*@=mustmod@*/
+		}
+	}
+
 	while ( size_read < value_size_total ){
 		/* find the size of the value */
-		nulbyte = (uintptr_t) memchr(
-			&blob[size_read], (int) ASCII_NUL,
-			value_size_total - size_read
-		);
-		value_size = (nulbyte == 0
-			? value_size_total - size_read
-			: (uint32_t) (nulbyte - (uintptr_t) &blob[size_read])
+		value_limit = value_size_total - size_read;
+		value_size  = slurp_nulscan_strlen(
+			scan, &blob[size_read], value_limit
 		);
 
 		/* add the value to the item */
@@ -433,19 +528,25 @@ slurp_item_value_text(
 			return SLURP_ERR_GSTRING;
 			/*@=mustdefine@*/ /*@=mustmod@*/
 		}
-		err = (int) apetag_memitem_add_value(item, &gs);
-		if ( err != 0 ){
-			/*@-mustdefine@*/ /*@-mustmod@*/
-			return SLURP_ERR_MEMTAG;
-			/*@=mustdefine@*/ /*@=mustmod@*/
+		if ( multi != NULL ){
+			assert(value_idx < nvalues);
+			multi[value_idx++] = gs;
+		}
+		else {	err = (int) apetag_memitem_add_value(item, &gs);
+			if ( err != 0 ){
+				/*@-mustdefine@*/ /*@-mustmod@*/
+				return SLURP_ERR_MEMTAG;
+				/*@=mustdefine@*/ /*@=mustmod@*/
+			}
 		}
 
-		size_read += value_size + (uint8_t) (nulbyte != 0);
+		size_read += value_size + (uint8_t) (value_size != value_limit);
 		if ( value_size > size_read ){
 			size_read += 1u;
 		}
 	}
 	assert(size_read == value_size_total);
+	assert((multi == NULL) || (value_idx == nvalues));
 
 	item->type = type;
 	*size_read_out = size_read;
@@ -456,13 +557,15 @@ slurp_item_value_text(
 static enum SlurpError
 slurp_item_value_binary(
 	/*@in@*/ struct Gatepa_Item *const item,
-	/*@out@*/ uint32_t *const size_read_out, const uint8_t *const blob,
+	/*@out@*/ uint32_t *const size_read_out,
+	struct Slurp_NulScan *const scan, const uint8_t *const blob,
 	const uint32_t value_size_total
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
 		*item,
-		*size_read_out
+		*size_read_out,
+		*scan
 @*/
 {
 	/* needs to be 'static' for gstring_ref_bstring() */
@@ -481,7 +584,12 @@ slurp_item_value_binary(
 	limit = (limit < (size_t) value_size_total
 		? limit : (size_t) value_size_total
 	);
-	nulbyte = (uintptr_t) memchr(blob, (int) ASCII_NUL, limit);
+	fname_size = (size_t) slurp_nulscan_strlen(
+		scan, blob, (uint32_t) limit
+	);
+	nulbyte    = (fname_size != limit
+		? (uintptr_t) &blob[fname_size] : 0
+	);
 	/* * */
 	data_start = (uint8_t *) (nulbyte + 1u);
 	fname_size = (size_t) (nulbyte - ((uintptr_t) blob) + 1u);
@@ -573,4 +681,108 @@ slurp_item_value_unknown(
 	return 0;
 }
 
+/* ------------------------------------------------------------------------ */
+
+/* returns the number of values in a text item: one per NUL, plus one for
+     the last value if it is not NUL-terminated
+*/
+PURE
+static uint32_t
+slurp_count_values(const uint8_t *const blob, const uint32_t size)
+/*@*/
+{
+	uint32_t retval = 0;
+	uint32_t i;
+
+	if ( size == 0 ){
+		return 0;
+	}
+
+	for ( i = 0; size - i >= (uint32_t) SWAR_SIZE; i += SWAR_SIZE ){
+		/* each zero byte becomes 0x01, then they are summed */
+		retval += (uint32_t) ((
+			(SWAR_ZEROS(swar_load(&blob[i])) >> 7u)
+			* SWAR_BYTES(0x01u)
+		) >> 56u);
+	}
+	for ( ; i < size; ++i ){
+		retval += (uint32_t) (blob[i] == ASCII_NUL);
+	}
+	return retval + (uint32_t) (blob[size - 1u] != ASCII_NUL);
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* indexes the NULs in the span of the blob that begins at 'start' */
+static void
+slurp_nulscan_sweep(struct Slurp_NulScan *const scan, const uint32_t start)
+/*@modifies	*scan@*/
+{
+	const uint8_t *const span = &scan->blob[start];
+	uint64_t zeros;
+	uint32_t bitlen, i;
+
+	assert(start < scan->size);
+
+	bitlen = scan->size - start;
+	bitlen = (bitlen < NULSCAN_SPAN ? bitlen : NULSCAN_SPAN);
+
+	/* a word at a time: gather the high bit of each zero byte into the
+	     low byte (little-endian, so byte n becomes bit n)
+	*/
+	for ( i = 0; bitlen - i >= (uint32_t) SWAR_SIZE; i += SWAR_SIZE ){
+		zeros = SWAR_ZEROS(byteswap_u64_letoh(swar_load(&span[i])));
+		scan->bits[i / 8u] = (uint8_t) (
+			((zeros >> 7u) * UINT64_C(0x0102040810204080)) >> 56u
+		);
+	}
+	/* then the leftover bytes */
+	if ( i < bitlen ){
+		scan->bits[i / 8u] = 0;
+		for ( ; i < bitlen; ++i ){
+			scan->bits[i / 8u] |= (uint8_t) (
+				(span[i] == ASCII_NUL) << (i % 8u)
+			);
+		}
+	}
+
+	scan->base   = start;
+	scan->bitlen = bitlen;
+	return;
+}
+
+/* returns the number of bytes before the first NUL in str[0, limit),
+     or 'limit' if there is none
+*/
+static uint32_t
+slurp_nulscan_strlen(
+	struct Slurp_NulScan *const scan, const uint8_t *const str,
+	const uint32_t limit
+)
+/*@modifies	*scan@*/
+{
+	const uint32_t start = (uint32_t) (str - scan->blob);
+	const uint32_t end   = start + limit;
+	uint32_t pos = start;
+	size_t found;
+
+	assert((str >= scan->blob) && (limit <= scan->size - start));
+
+	while ( pos < end ){
+		if ( (pos < scan->base) || (pos - scan->base >= scan->bitlen) ){
+			slurp_nulscan_sweep(scan, pos);
+		}
+		found = bitset_find_1(
+			scan->bits, (size_t) scan->bitlen,
+			(size_t) (pos - scan->base)
+		);
+		if ( found != SIZE_MAX ){
+			found += scan->base;
+			return (found < end ? (uint32_t) found - start : limit);
+		}
+		pos = scan->base + scan->bitlen;
+	}
+	return limit;
+}
+
 /* EOF //////////////////////////////////////////////////////////////////// */
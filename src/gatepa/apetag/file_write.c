@@ -46,6 +46,11 @@ static size_t apetag_construct_item(
 /*@modifies	*buf@*/
 ;
 
+#undef buf
+static size_t apetag_construct_padding(/*@out@*/ uint8_t *buf, size_t, size_t)
+/*@modifies	*buf@*/
+;
+
 /* //////////////////////////////////////////////////////////////////////// */
 
 /* returns 0 on success */
@@ -186,53 +191,61 @@ apetag_size_item_values(
 
 /* ======================================================================== */
 
-/* returns 0 on success */
-GATEPA enum GatepaErr
-apetag_write_tag_header(
-	const nbufio_fd fd, const uint32_t tag_size, const uint32_t tag_nmemb
+/* returns the number of bytes written to the buffer */
+GATEPA size_t
+apetag_construct_tag_header(
+	/*@out@*/ uint8_t *const buf,
+	const uint32_t tag_size, const uint32_t tag_nmemb
 )
-/*@globals	fileSystem,
-		internalState
-@*/
-/*@modifies	fileSystem,
-		internalState
-@*/
+/*@modifies	*buf@*/
 {
 	struct ApeTag_TagHF header;
-	size_t err;
 
 	header = apetag_taghf_make(
 		tag_size, tag_nmemb, APEFLAG_NO_READONLY,
 		APEFLAG_IS_HEADER | APEFLAG_HAS_FOOTER | APEFLAG_HAS_HEADER
 	);
-	err = nbufio_write(fd, &header, sizeof header);
+	(void) memcpy(buf, &header, sizeof header);
 
-	return (err != NBUFIO_RW_ERROR ? 0 : GATERR_IO_WRITE);
+	return sizeof header;
 }
 
 /* returns the number of bytes written to the buffer */
 /* not overflow checking here, because we should be good */
+/* pad_size is the size of the padding item (0 for none), which buf_size
+     includes
+*/
 GATEPA size_t
 apetag_construct_tag(
 	/*@out@*/ uint8_t *const buf, const size_t buf_size,
-	const struct Gatepa_Tag *const tag, const enum Write_TagType type
+	const struct Gatepa_Tag *const tag, const enum Write_TagType type,
+	const size_t pad_size
 )
 /*@modifies	*buf@*/
 {
 	struct ApeTag_TagHF hf;
 	unsigned int has_header;
 	size_t buf_idx = 0;
+	uint32_t nmemb = tag->nmemb;
 	uint32_t i;
 
+	assert((pad_size == 0) || (pad_size >= GATEPA_PADDING_MIN));
+
 	/* write each item */
 	for ( i = 0; i < tag->nmemb; ++i ){
 		buf_idx = apetag_construct_item(buf, buf_idx, tag, i);
 	}
 
+	/* write the padding item */
+	if ( pad_size != 0 ){
+		buf_idx = apetag_construct_padding(buf, buf_idx, pad_size);
+		nmemb  += 1u;
+	}
+
 	/* create/write tag footer */
 	has_header = (type == TAGTYPE_LONG ? APEFLAG_HAS_HEADER : 0);
 	hf = apetag_taghf_make(
-		buf_size, tag->nmemb, APEFLAG_NO_READONLY,
+		buf_size, nmemb, APEFLAG_NO_READONLY,
 		APEFLAG_IS_FOOTER | APEFLAG_HAS_FOOTER | has_header
 	);
 	(void) memcpy(&buf[buf_idx], &hf, sizeof hf);
@@ -304,4 +317,36 @@ apetag_construct_item(
 	return buf_idx;
 }
 
+/* returns the new 'buf_idx' */
+static size_t
+apetag_construct_padding(
+	/*@out@*/ uint8_t *const buf, size_t buf_idx, const size_t pad_size
+)
+/*@modifies	*buf@*/
+{
+	const uint8_t key[] = GATEPA_PADDING_KEY;
+	const size_t value_size = pad_size - GATEPA_PADDING_MIN;
+	/* * */
+	struct ApeTag_ItemH header;
+
+	assert(pad_size >= GATEPA_PADDING_MIN);
+
+	/* header */
+	header = apetag_itemh_make(
+		(uint32_t) value_size, APEFLAG_ITEMTYPE_BINARY
+	);
+	(void) memcpy(&buf[buf_idx], &header, sizeof header);
+	buf_idx += sizeof header;
+
+	/* key */
+	(void) memcpy(&buf[buf_idx], key, sizeof key);
+	buf_idx += sizeof key;
+
+	/* value */
+	(void) memset(&buf[buf_idx], 0x00, value_size);
+	buf_idx += value_size;
+
+	return buf_idx;
+}
+
 /* EOF //////////////////////////////////////////////////////////////////// */
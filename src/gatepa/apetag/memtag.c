@@ -10,6 +10,7 @@
 /////////////////////////////////////////////////////////////////////////// */
 
 #include <assert.h>
+#include <stdbool.h>
 #include <stddef.h>
 #include <string.h>
 
@@ -36,9 +37,23 @@
 	10: track
 	11: genre
 	12: comment
+
+	past that, the arrays grow by half (the arena never frees the old ones)
 */
 #define MEMTAG_NMEMB_MOD	((uint32_t) 12u)
 
+/* a tag gets a key index once it holds this many items; a linear scan is
+     cheaper than hashing the key for fewer than that
+*/
+#define MEMTAG_INDEX_NMEMB_MIN	((uint32_t) 16u)
+
+/* bytes of the folded key prefix */
+#define MEMTAG_FOLD_SIZE	((uint32_t) 8u)
+
+/* FNV-1a (32-bit) */
+#define MEMTAG_HASH_BASIS	((uint32_t) 0x811C9DC5u)
+#define MEMTAG_HASH_PRIME	((uint32_t) 0x01000193u)
+
 /* //////////////////////////////////////////////////////////////////////// */
 
 /* returns NULL on failure */
@@ -78,21 +93,233 @@ apetag_memtag_realloc(
 	return retval;
 }
 
+/* ------------------------------------------------------------------------ */
+
+/* keys compare case-insensitively, folded to uppercase like ascii_casecmp(),
+     so each key gets (once, when its Gatepa_Key is made) a folded:
+	- prefix: the first MEMTAG_FOLD_SIZE bytes, big-endian and zero-padded,
+	  so that comparing two prefixes as integers orders them like the keys
+	- hash: FNV-1a of the whole key, for the index
+*/
+static void
+memtag_key_fold(
+	/*@out@*/ uint64_t *const fold_out, /*@out@*/ uint32_t *const hash_out,
+	const struct GString *const key
+)
+/*@modifies	*fold_out,
+		*hash_out
+@*/
+{
+	const uint8_t *const str = GSTRING_PTR(key);
+	uint64_t fold = 0;
+	uint32_t hash = MEMTAG_HASH_BASIS;
+	uint8_t c;
+	uint32_t i;
+
+	for ( i = 0; i < key->len; ++i ){
+		c     = ascii_toupper(str[i]);
+		hash ^= (uint32_t) c;
+		hash *= MEMTAG_HASH_PRIME;
+		if ( i < MEMTAG_FOLD_SIZE ){
+			fold |= ((uint64_t) c) << (56u - (8u * i));
+		}
+	}
+	*fold_out = fold;
+	*hash_out = hash;
+	return;
+}
+
+/* returns like gstring_cmp_gstring() with ascii_casecmp(), but only reads
+     the keys themselves when both prefixes match and neither key ends
+     inside them
+*/
+PURE
+static int
+memtag_key_cmp(
+	const struct GString *const a, const uint64_t a_fold,
+	const struct GString *const b, const uint64_t b_fold
+)
+/*@*/
+{
+	if ( a_fold != b_fold ){
+		return (a_fold < b_fold ? -1 : 1);
+	}
+	if ( (a->len <= MEMTAG_FOLD_SIZE) || (b->len <= MEMTAG_FOLD_SIZE) ){
+		return ((int) (a->len > b->len)) - ((int) (a->len < b->len));
+	}
+	return gstring_cmp_gstring(a, b, ascii_casecmp);
+}
+
+/* tag->index must have a free slot */
+static void
+memtag_index_insert(struct Gatepa_Tag *const tag, const uint32_t idx)
+/*@modifies	tag->index[]@*/
+{
+	uint32_t i;
+
+	assert(tag->index != NULL);
+
+	i = tag->hash[idx] & tag->index_mask;
+	while ( tag->index[i] != 0 ){
+		i = (i + 1u) & tag->index_mask;
+	}
+	tag->index[i] = idx + 1u;
+	return;
+}
+
+/* keys are inserted in ascending order, so the first key a probe finds is
+     the same one a linear scan would
+*/
+static void
+memtag_index_fill(struct Gatepa_Tag *const tag)
+/*@modifies	tag->index[]@*/
+{
+	uint32_t i;
+
+	assert(tag->index != NULL);
+
+	memset(tag->index, 0, (tag->index_mask + 1u) * sizeof tag->index[0]);
+	for ( i = 0; i < tag->nmemb; ++i ){
+		memtag_index_insert(tag, i);
+	}
+	return;
+}
+
+static void
+memtag_index_drop(struct Gatepa_Tag *const tag)
+/*@modifies	tag->index,
+		tag->index_mask
+@*/
+{
+	tag->index	= NULL;
+	tag->index_mask	= 0;
+	return;
+}
+
+/* (re)allocates the index so that it is at most half full;
+     on failure the tag just goes without an index
+*/
+static void
+memtag_index_grow(struct Gatepa_Tag *const tag)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*tag
+@*/
+{
+	uint32_t index_nmemb;
+
+	if ( tag->nmemb_max > (UINT32_MAX / 4u) ){
+		memtag_index_drop(tag);
+		return;
+	}
+	index_nmemb = (uint32_t) 2u * MEMTAG_INDEX_NMEMB_MIN;
+	while ( index_nmemb <= (uint32_t) 2u * tag->nmemb ){
+		index_nmemb *= 2u;
+	}
+
+	tag->index = gatepa_alloc_a16(
+		sizeof *tag->index, (size_t) index_nmemb
+	);
+	if ( tag->index == NULL ){
+		memtag_index_drop(tag);
+		return;
+	}
+	tag->index_mask = index_nmemb - 1u;
+	memtag_index_fill(tag);
+	return;
+}
+
+/* grows the parallel arrays by nmemb_mod */
+/* returns 0 on success */
+static enum GatepaErr
+memtag_resize(struct Gatepa_Tag *const tag, const uint32_t nmemb_mod)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*tag
+@*/
+{
+	void *new_key_array, *new_item_array;
+	void *new_fold_array, *new_hash_array;
+	uint32_t temp_nmemb;
+
+	new_key_array  = apetag_memtag_realloc(
+		tag->key, NULL, sizeof tag->key[0], tag->nmemb, nmemb_mod
+	);
+	new_item_array = apetag_memtag_realloc(
+		tag->item, &temp_nmemb, sizeof tag->item[0], tag->nmemb,
+		nmemb_mod
+	);
+	new_fold_array = apetag_memtag_realloc(
+		tag->fold, NULL, sizeof tag->fold[0], tag->nmemb, nmemb_mod
+	);
+	new_hash_array = apetag_memtag_realloc(
+		tag->hash, NULL, sizeof tag->hash[0], tag->nmemb, nmemb_mod
+	);
+	if ( (new_key_array  == NULL) || (new_item_array == NULL)
+	    ||
+	     (new_fold_array == NULL) || (new_hash_array == NULL)
+	){
+		return GATERR_ALLOCATOR;
+	}
+	tag->key	= new_key_array;
+	tag->item	= new_item_array;
+	tag->fold	= new_fold_array;
+	tag->hash	= new_hash_array;
+	tag->nmemb_max	= temp_nmemb;
+
+	return 0;
+}
+
 /* ======================================================================== */
 
+/* folds a key for any number of apetag_memtag_*() calls */
+GATEPA void
+apetag_memkey_make(
+	/*@out@*/ struct Gatepa_Key *const memkey,
+	const struct GString *const key
+)
+/*@modifies	*memkey@*/
+{
+	memkey->str = *key;
+	memtag_key_fold(&memkey->fold, &memkey->hash, key);
+	return;
+}
+
 /* returns the index of the item, or UINT32_MAX if the item does not exist */
 NOINLINE PURE
 GATEPA uint32_t
 apetag_memtag_find_item(
-	const struct Gatepa_Tag *const tag, const struct GString *const key
+	const struct Gatepa_Tag *const tag,
+	const struct Gatepa_Key *const memkey
 )
 /*@*/
 {
+	const struct GString *const key  = &memkey->str;
+	const uint64_t              fold = memkey->fold;
+	const uint32_t              hash = memkey->hash;
+	/* * */
+	uint32_t slot, i;
 	int cmp;
-	uint32_t i;
+
+	if ( tag->index != NULL ){
+		i = hash & tag->index_mask;
+		while ( (slot = tag->index[i]) != 0 ){
+			if ( tag->hash[slot - 1u] == hash ){
+				cmp = memtag_key_cmp(
+					key, fold, &tag->key[slot - 1u],
+					tag->fold[slot - 1u]
+				);
+				if ( cmp == 0 ){
+					return slot - 1u;
+				}
+			}
+			i = (i + 1u) & tag->index_mask;
+		}
+		return UINT32_MAX;
+	}
 
 	for ( i = 0; i < tag->nmemb; ++i ){
-		cmp = gstring_cmp_gstring(key, &tag->key[i], ascii_casecmp);
+		cmp = memtag_key_cmp(key, fold, &tag->key[i], tag->fold[i]);
 		if ( cmp == 0 ){
 			return i;
 		}
@@ -100,11 +327,41 @@ apetag_memtag_find_item(
 	return UINT32_MAX;
 }
 
+/* returns like memcmp(), comparing the keys like ascii_casecmp() */
+PURE
+GATEPA int
+apetag_memtag_cmp_key(
+	const struct Gatepa_Tag *const tag, const uint32_t a_idx,
+	const uint32_t b_idx
+)
+/*@*/
+{
+	return memtag_key_cmp(
+		&tag->key[a_idx], tag->fold[a_idx],
+		&tag->key[b_idx], tag->fold[b_idx]
+	);
+}
+
+/* makes room for (at least) nmemb items in total */
+/* returns 0 on success */
+GATEPA enum GatepaErr
+apetag_memtag_reserve(struct Gatepa_Tag *const tag, const uint32_t nmemb)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*tag
+@*/
+{
+	if ( nmemb <= tag->nmemb_max ){
+		return 0;
+	}
+	return memtag_resize(tag, nmemb - tag->nmemb);
+}
+
 /* returns 0 on success */
 NOINLINE
 GATEPA enum GatepaErr
 apetag_memtag_add_item(
-	struct Gatepa_Tag *const tag, const struct GString *const key,
+	struct Gatepa_Tag *const tag, const struct Gatepa_Key *const memkey,
 	const struct Gatepa_Item *const item
 )
 /*@globals	internalState@*/
@@ -112,46 +369,56 @@ apetag_memtag_add_item(
 		*tag
 @*/
 {
-	void *new_key_array, *new_item_array;
-	uint32_t temp_nmemb;
+	enum GatepaErr err;
 
 	/* check if the arrays need to be resized */
 	if ( tag->nmemb == tag->nmemb_max ){
-		new_key_array  = apetag_memtag_realloc(
-			tag->key, NULL, sizeof tag->key[0],
-			tag->nmemb, MEMTAG_NMEMB_MOD
-		);
-		new_item_array = apetag_memtag_realloc(
-			tag->item, &temp_nmemb, sizeof tag->item[0],
-			tag->nmemb, MEMTAG_NMEMB_MOD
-		);
-		if ( (new_key_array == NULL) || (new_item_array == NULL) ){
-			return GATERR_ALLOCATOR;
+		err = memtag_resize(tag, (tag->nmemb / 2u > MEMTAG_NMEMB_MOD
+			? tag->nmemb / 2u : MEMTAG_NMEMB_MOD
+		));
+		if ( err != 0 ){
+			return err;
 		}
-		tag->key	 = new_key_array;
-		tag->item	 = new_item_array;
-		tag->nmemb_max	 = temp_nmemb;
 	}
 	assert((tag->key != NULL) && (tag->item != NULL));
+	assert((tag->fold != NULL) && (tag->hash != NULL));
 
 	/* update the arrays */
-	tag->key [tag->nmemb]	 = *key;
+	tag->key [tag->nmemb]	 = memkey->str;
 	tag->item[tag->nmemb]	 = *item;
+	tag->fold[tag->nmemb]	 = memkey->fold;
+	tag->hash[tag->nmemb]	 = memkey->hash;
 	tag->nmemb		+= 1u;
 
+	/* update the index */
+	if ( tag->index != NULL ){
+		if ( (uint32_t) 2u * tag->nmemb > tag->index_mask ){
+			memtag_index_grow(tag);
+		}
+		else {	memtag_index_insert(tag, tag->nmemb - 1u); }
+	}
+	else if ( tag->nmemb >= MEMTAG_INDEX_NMEMB_MIN ){
+		memtag_index_grow(tag);
+	}
+
 	return 0;
 }
 
 GATEPA void
 apetag_memtag_rename_item(
 	struct Gatepa_Tag *const tag, const uint32_t item_idx,
-	const struct GString *const new_key
+	const struct Gatepa_Key *const new_memkey
 )
-/*@modifies	tag->key[]@*/
+/*@modifies	*tag@*/
 {
 	assert(item_idx < tag->nmemb);
 
-	tag->key[item_idx] = *new_key;
+	tag->key [item_idx] = new_memkey->str;
+	tag->fold[item_idx] = new_memkey->fold;
+	tag->hash[item_idx] = new_memkey->hash;
+	if ( tag->index != NULL ){
+		memtag_index_fill(tag);
+	}
 	return;
 }
 
@@ -171,6 +438,7 @@ apetag_memtag_clear(struct Gatepa_Tag *const tag)
 /*@modifies	*tag@*/
 {
 	tag->nmemb = 0;
+	memtag_index_drop(tag);
 	return;
 }
 
@@ -215,11 +483,48 @@ apetag_memtag_remove_item(struct Gatepa_Tag *const tag, const uint32_t idx)
 	/* nmemb */
 	tag->nmemb -= 1u;
 
+	/* fold & hash (no larger than the key) */
+	if ( idx != tag->nmemb ){
+		(void) memmove(
+			&tag->fold[idx], &tag->fold[idx + 1u],
+			(size_t) (tag->nmemb - idx) * sizeof tag->fold[0]
+		);
+		(void) memmove(
+			&tag->hash[idx], &tag->hash[idx + 1u],
+			(size_t) (tag->nmemb - idx) * sizeof tag->hash[0]
+		);
+	}
+
+	/* index */
+	if ( tag->index != NULL ){
+		memtag_index_fill(tag);
+	}
+
 	return 0;
 }
 
+/* for after the keys have been reordered in place */
+GATEPA void
+apetag_memtag_reindex(struct Gatepa_Tag *const tag)
+/*@modifies	*tag@*/
+{
+	uint32_t i;
+
+	for ( i = 0; i < tag->nmemb; ++i ){
+		memtag_key_fold(&tag->fold[i], &tag->hash[i], &tag->key[i]);
+	}
+	if ( tag->index != NULL ){
+		memtag_index_fill(tag);
+	}
+	return;
+}
+
 /* ======================================================================== */
 
+/* a multi array holds the next power of 2 up from its nmemb, so it only
+     needs to grow (doubling) when nmemb is a power of 2
+*/
+
 /* returns 0 on success */
 NOINLINE
 GATEPA enum GatepaErr
@@ -238,11 +543,15 @@ apetag_memitem_add_value(
 		/* single */
 		item->value.single = *gs;
 	}
-	else {	/* multi */
+	else if ( (item->nmemb & (item->nmemb - 1u)) != 0 ){
+		/* multi, with room */
+		item->value.multi[item->nmemb] = *gs;
+	}
+	else {	/* multi, full (or still single, which becomes 2 values) */
 		new_multi = apetag_memtag_realloc(
 			item->value.multi, NULL, sizeof item->value.multi[0],
 			(item->nmemb == (uint32_t) 1u ? 0u : item->nmemb),
-			(uint32_t) 1u
+			(item->nmemb == (uint32_t) 1u ? 2u : item->nmemb)
 		);
 		if ( new_multi == NULL ){
 			return GATERR_ALLOCATOR;
@@ -258,17 +567,66 @@ apetag_memitem_add_value(
 	return 0;
 }
 
-GATEPA void
+/* makes an empty item a multi item of nmemb (> 1) values, for the caller to
+     fill in, with a single allocation
+*/
+/* returns the values array, or NULL on failure */
+/*@temp@*/ /*@null@*/ /*@reldef@*/
+GATEPA struct GString *
+apetag_memitem_multi_init(
+	struct Gatepa_Item *const item, const uint32_t nmemb
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		item->value,
+		item->nmemb
+@*/
+{
+	struct GString *multi;
+	uint32_t nmemb_max = (uint32_t) 2u;
+
+	assert((item->nmemb == 0) && (nmemb > (uint32_t) 1u));
+
+	while ( nmemb_max < nmemb ){
+		if ( nmemb_max > UINT32_MAX / 2u ){
+			return NULL;
+		}
+		nmemb_max *= 2u;
+	}
+	multi = gatepa_alloc_a16(sizeof *multi, (size_t) nmemb_max);
+	if ( multi == NULL ){
+		return NULL;
+	}
+
+	item->value.multi = multi;
+	item->nmemb       = nmemb;
+	return multi;
+}
+
+/* returns whether the item changed */
+GATEPA bool
 apetag_memitem_replace_value(
 	struct Gatepa_Item *const item, const struct GString *const value,
 	const enum ApeFlag_ItemType type
 )
 /*@modifies	*item@*/
 {
+	bool changed = true;
+
+	if ( (item->type == type) && (item->nmemb == (uint32_t) 1u)
+	    &&
+	     (item->value.single.len == value->len)
+	){
+		changed = (memcmp(
+			GSTRING_PTR(&item->value.single), GSTRING_PTR(value),
+			(size_t) value->len
+		) != 0);
+	}
+
 	item->value.single	= *value;
 	item->nmemb		= (uint32_t) 1u;
 	item->type		= type;
-	return;
+	return changed;
 }
 
 /* EOF //////////////////////////////////////////////////////////////////// */
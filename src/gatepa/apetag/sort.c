@@ -24,13 +24,6 @@
 
 /* //////////////////////////////////////////////////////////////////////// */
 
-PURE
-static int cmp_item(
-	const struct Gatepa_Tag *, uint32_t, uint32_t, enum Sort_TagCompar
-)
-/*@*/
-;
-
 PURE
 static int cmp_item_score(
 	const struct Gatepa_Tag *, uint32_t, enum Sort_TagCompar
@@ -53,9 +46,6 @@ static int cmp_item_score_text_audio(const struct Gatepa_Tag *, uint32_t)
 PURE
 static int get_stak_idx(const uint8_t *, size_t) /*@*/;
 
-PURE
-static int cmp_item_fbu(const struct Gatepa_Tag *, uint32_t, uint32_t) /*@*/;
-
 PURE
 static uint32_t cmp_item_fbu_size(const struct Gatepa_Tag *, uint32_t) /*@*/;
 
@@ -69,73 +59,62 @@ static uint32_t cmp_item_fbu_size(const struct Gatepa_Tag *, uint32_t) /*@*/;
 
 /* //////////////////////////////////////////////////////////////////////// */
 
-/* returns like a qsort comparison function */
-PURE
-GATEPA int
-apetag_compar_audio(
-	const void *const a, const void *const b, void *const arg
+/* fills in the columns for each item of columns->tag */
+GATEPA void
+apetag_sort_columns(
+	struct Sort_Columns *const columns, const enum Sort_TagCompar type
 )
-/*@*/
+/*@modifies	columns->score[],
+		columns->size[]
+@*/
 {
-	const uint32_t a_idx = *((uint32_t *) a);
-	const uint32_t b_idx = *((uint32_t *) b);
-	const struct Gatepa_Tag *const tag = arg;
-
-	return cmp_item(tag, a_idx, b_idx, TAGCOMPAR_AUDIO);
+	const struct Gatepa_Tag *const tag = columns->tag;
+	/* * */
+	int score;
+	uint32_t i;
+
+	for ( i = 0; i < tag->nmemb; ++i ){
+		score = cmp_item_score(tag, i, type);
+		columns->score[i] = (int8_t) score;
+		columns->size[i]  = (score == ITEMCMPSCORE_FBU
+			? cmp_item_fbu_size(tag, i) : 0
+		);
+	}
+	return;
 }
 
+/* 'arg' is the tag's filled-in columns */
 /* returns like a qsort comparison function */
 PURE
 GATEPA int
-apetag_compar_alpha(
+apetag_compar_columns(
 	const void *const a, const void *const b, void *const arg
 )
 /*@*/
 {
 	const uint32_t a_idx = *((uint32_t *) a);
 	const uint32_t b_idx = *((uint32_t *) b);
-	const struct Gatepa_Tag *const tag = arg;
-
-	return cmp_item(tag, a_idx, b_idx, TAGCOMPAR_ALPHA);
-}
-
-/* ------------------------------------------------------------------------ */
-
-/* returns like a qsort comparison function */
-PURE
-static int
-cmp_item(
-	const struct Gatepa_Tag *const tag,
-	const uint32_t a_idx, const uint32_t b_idx,
-	const enum Sort_TagCompar type
-)
-/*@*/
-{
-	const int score_a = cmp_item_score(tag, a_idx, type);
-	const int score_b = cmp_item_score(tag, b_idx, type);
+	const struct Sort_Columns *const columns = arg;
 	/* * */
-/*	int cmp = ((int) (score_a > score_b)) - ((int) (score_a < score_b));
-*/	int cmp = score_a - score_b;
+	const int score_a = (int) columns->score[a_idx];
+	const int score_b = (int) columns->score[b_idx];
+	const uint32_t size_a = columns->size[a_idx];
+	const uint32_t size_b = columns->size[b_idx];
+	/* * */
+	int cmp = score_a - score_b;
 
 	if ( cmp == 0 ){
-		switch ( score_a ){
-		case ITEMCMPSCORE_FBU:
-			cmp = cmp_item_fbu(tag, a_idx, b_idx);
-			if ( cmp != 0 ){
-				break;
-			}
-			/*@fallthrough@*/
-		default:
-			cmp = gstring_cmp_gstring(
-				&tag->key[a_idx], &tag->key[b_idx],
-				ascii_casecmp
-			);
-			break;
-		}
+		/* FBU: size then alpha (the size is 0 for the others) */
+		cmp = ((int) (size_a > size_b)) - ((int) (size_a < size_b));
+	}
+	if ( cmp == 0 ){
+		cmp = apetag_memtag_cmp_key(columns->tag, a_idx, b_idx);
 	}
 	return cmp;
 }
 
+/* ------------------------------------------------------------------------ */
+
 /*
    0:	custom ordering (not implemented)
    1.a: [TAGCOMPAR_AUDIO] TEXT with an underscore in the key
@@ -282,23 +261,6 @@ get_stak_idx(const uint8_t *const data, const size_t len)
 	return stak_idx;
 }
 
-/* returns like a qsort comparison function */
-PURE
-static int
-cmp_item_fbu(
-	const struct Gatepa_Tag *const tag,
-	const uint32_t a_idx, const uint32_t b_idx
-)
-/*@*/
-{
-	const uint32_t size_a = cmp_item_fbu_size(tag, a_idx);
-	const uint32_t size_b = cmp_item_fbu_size(tag, b_idx);
-	/* * */
-	int cmp = ((int) (size_a > size_b)) - ((int) (size_a < size_b));
-
-	return cmp;
-}
-
 /* returns the size of the item */
 PURE
 static uint32_t
@@ -80,6 +80,11 @@ static const char *const f_gatepa_strerror[GATEPA_NUM_ERRORS] = {
 	"i/o read error",
 	"i/o write error",
 	"i/o truncate error",
+	"i/o close error",
+	"i/o sync error",
+
+	"journal holds unfinished writes (use --recover)",
+	"malformed journal",
 
 	"only one tag may be selected for this mode",
 	"mismatched item types",
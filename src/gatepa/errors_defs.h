@@ -64,6 +64,11 @@ enum GatepaErr {
 	GATERR_IO_READ,
 	GATERR_IO_WRITE,
 	GATERR_IO_TRUNCATE,
+	GATERR_IO_CLOSE,
+	GATERR_IO_SYNC,
+
+	GATERR_JOURNAL_PENDING,
+	GATERR_JOURNAL_MALFORMED,
 
 	GATERR_SINGLE_TAG_ONLY,
 	GATERR_MISMATCHED_ITEM_TYPES,
@@ -55,16 +55,42 @@ static const char f_str_help_usage[] = {
 static const char f_str_help_opts[] = {
 /*12345670123456701234567012345670123456701234567012345670123456701234567012*/
 " Options:"
+"\n\t"  "--arena-block"
+                "\t\t\t"                "arena block size, a power of 2"
 "\n\t"  "--help[=mode]"
                 "\t\t\t"                "Print this help, or a mode's help."
+"\n\t"  "--hugepages"
+                "\t\t\t"                "back the arenas with 2 MiB hugepages"
+"\n\t"  "--io-uring"
+                "\t\t\t"                "batch the tag reads with io_uring"
+"\n\t"  "--jobs"
+                "\t\t\t\t"              "number of threads for reading tags"
+"\n\t"  "--journal=file"
+                "\t\t\t"                "(write) journal; implies --sync=batch"
 "\n\t"  "--limit-binary-fext"
                              "\t\t"     "(read) binary file-extension limit"
 "\n\t"  "--limit-binary-name"
                              "\t\t"     "(read) binary name limit"
+"\n\t"  "--mmap"
+                "\t\t\t\t"              "map the files for read-only modes"
+"\n\t"  "--pad-percent"
+                "\t\t\t"                "(write) padding, as a % of the tag"
+"\n\t"  "--pad-size"
+                "\t\t\t"                "(write) padding, in bytes"
+"\n\t"  "--recover"
+                "\t\t\t"                "restore the tags from the --journal"
 "\n\t"  "--softlimit-items-size"
                              "\t\t"     "(verify) tag items size softlimit"
 "\n\t"  "--softlimit-key-size"
                              "\t\t"     "(verify) item key size softlimit"
+"\n\t"  "--stats"
+                "\t\t\t\t"              "print arena, time, and syscall stats"
+"\n\t"  "--sync=none|batch|file"
+                             "\t\t"     "(write) when to flush the files"
+"\n\t"  "--tail-size"
+                "\t\t\t"                "bytes read at once from a file's end"
+"\n\t"  "--window"
+                "\t\t\t"                "files at a time (output by window)"
 "\n\n"
 };
 
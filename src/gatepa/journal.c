@@ -0,0 +1,451 @@
+/* ///////////////////////////////////////////////////////////////////////////
+//                                                                          //
+// journal.c                                                                //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+// Copyright (C) 2025, Shane Seelig                                         //
+// SPDX-License-Identifier: GPL-3.0-or-later                                //
+//                                                                          //
+/////////////////////////////////////////////////////////////////////////// */
+
+#include <assert.h>
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#include <libs/ascii-literals.h>
+#include <libs/byteswap.h>
+#include <libs/nbufio.h>
+#include <libs/overflow.h>
+
+#include "alloc.h"
+#include "apetag.h"
+#include "attributes.h"
+#include "errors.h"
+#include "journal.h"
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+/*@checkmod@*/
+struct Journal_Globals g_journal = {
+	.path		= NULL,
+	.recover	= false
+};
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+#define JOURNAL_REC_MAGIC	{ \
+	ASCII_G_UP, ASCII_P_UP, ASCII_J_UP, ASCII_1 \
+}
+
+#define JOURNAL_MODE		((mode_t) 0644)	/* rw-r--r-- */
+
+/* 24u bytes, followed by the old tag bytes, then the (unterminated) path */
+struct Journal_Rec {
+	uint8_t		magic[4u];	/* .ascii "GPJ1"                    */
+	uint32_le	name_len;	/* length of the path               */
+	uint64_le	off_begin;	/* where the old tag began          */
+	uint64_le	off_end;	/* the old EOF                      */
+};
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+/*@unchecked@*/
+static nbufio_fd f_journal_fd = NBUFIO_FD_ERROR;
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+static enum GatepaErr journal_restore(
+	const char *, const uint8_t *, off_t, off_t
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+;
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+/* opens/creates and write-locks the journal, which must be empty */
+/* returns 0 on success */
+GATEPA enum GatepaErr
+journal_open(void)
+/*@globals	fileSystem,
+		internalState,
+		g_journal,
+		f_journal_fd
+@*/
+/*@modifies	fileSystem,
+		internalState,
+		f_journal_fd
+@*/
+{
+	nbufio_fd fd;
+	off_t size;
+	int err;
+
+	assert(g_journal.path != NULL);
+
+	fd = nbufio_create(g_journal.path, O_RDWR | O_APPEND, JOURNAL_MODE);
+	if ( fd == NBUFIO_FD_ERROR ){
+		return GATERR_IO_OPEN;
+	}
+	err = nbufio_lock(fd, LOCK_EX | LOCK_NB);
+	if ( err != 0 ){
+		(void) nbufio_close(fd);
+		return GATERR_IO_WRITELOCK;
+	}
+	size = nbufio_seek(fd, 0, SEEK_END);
+	if ( size != 0 ){
+		(void) nbufio_close(fd);
+		return (size != NBUFIO_OFF_ERROR
+			? GATERR_JOURNAL_PENDING : GATERR_IO_SEEK
+		);
+	}
+
+	f_journal_fd = fd;
+	return 0;
+}
+
+/* removes the (empty) journal */
+/* returns 0 on success */
+GATEPA enum GatepaErr
+journal_close(void)
+/*@globals	fileSystem,
+		internalState,
+		g_journal,
+		f_journal_fd
+@*/
+/*@modifies	fileSystem,
+		internalState,
+		f_journal_fd
+@*/
+{
+	int err;
+
+	if ( f_journal_fd == NBUFIO_FD_ERROR ){
+		return 0;
+	}
+	assert(g_journal.path != NULL);
+
+	/* unlink while still locked */
+	(void) unlink(g_journal.path);
+	err = nbufio_close(f_journal_fd);
+	f_journal_fd = NBUFIO_FD_ERROR;
+
+	return (err == 0 ? 0 : GATERR_IO_CLOSE);
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* disk is the old tag as read (off_begin to the EOF), or NULL to read it */
+/* the path is recorded absolute, so --recover may run from any directory */
+/* returns 0 on success */
+GATEPA enum GatepaErr
+journal_batch_add(
+	const char *const name, const nbufio_fd fd,
+	const struct Gatepa_FileInfo *const info,
+	/*@null@*/ const uint8_t *const disk
+)
+/*@globals	fileSystem,
+		internalState,
+		f_journal_fd
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+{
+	const off_t off_end = (info->off_end != NBUFIO_OFF_ERROR
+		? info->off_end : info->off_begin
+	);
+	/* * */
+	struct Journal_Rec rec = { JOURNAL_REC_MAGIC, 0, 0, 0 };
+	char path[PATH_MAX];
+	uint8_t *buf;
+	size_t name_len, size_old, rec_size;
+	union {	int	i;
+		size_t	z;
+	} err;
+
+	assert(f_journal_fd != NBUFIO_FD_ERROR);
+
+	if ( realpath(name, path) == NULL ){
+		return GATERR_IO_OPEN;
+	}
+	name_len = strlen(path);
+
+	if ( (uintmax_t) (off_end - info->off_begin) > SIZE_MAX ){
+		return GATERR_OVERFLOW;
+	}
+	size_old = (size_t) (off_end - info->off_begin);
+	if ( name_len > (size_t) UINT32_MAX ){
+		return GATERR_OVERFLOW;
+	}
+	err.i  = add_usize_overflow(&rec_size, sizeof rec, size_old);
+	err.i |= add_usize_overflow(&rec_size, rec_size, name_len);
+	if ( err.i != 0 ){
+		return GATERR_OVERFLOW;
+	}
+
+	/* build the record in one buffer, so it's appended in one write */
+	err.i = gatepa_alloc_scratch_reset();
+	if ( err.i != 0 ){
+		return GATERR_ALLOCATOR;
+	}
+	buf = gatepa_alloc_scratch(rec_size, (size_t) 1u);
+	if ( buf == NULL ){
+		return GATERR_ALLOCATOR;
+	}
+	rec.name_len  = byteswap_u32_htole((uint32_t) name_len);
+	rec.off_begin = byteswap_u64_htole((uint64_t) info->off_begin);
+	rec.off_end   = byteswap_u64_htole((uint64_t) off_end);
+	(void) memcpy(buf, &rec, sizeof rec);
+	if ( disk != NULL ){
+		(void) memcpy(&buf[sizeof rec], disk, size_old);
+	}
+	else {	err.z = nbufio_pread(
+			fd, &buf[sizeof rec], size_old, info->off_begin
+		);
+		if ( err.z != size_old ){
+			return (err.z != NBUFIO_RW_ERROR
+				? GATERR_IO_READ_EOF : GATERR_IO_READ
+			);
+		}
+	}
+	(void) memcpy(&buf[sizeof rec + size_old], path, name_len);
+
+	err.z = nbufio_write(f_journal_fd, buf, rec_size);
+	if ( err.z != rec_size ){
+		return GATERR_IO_WRITE;
+	}
+	return 0;
+}
+
+/* once per batch, before any of its files are written */
+/* returns 0 on success */
+GATEPA enum GatepaErr
+journal_batch_sync(void)
+/*@globals	fileSystem,
+		internalState,
+		f_journal_fd
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+{
+	int err;
+
+	assert(f_journal_fd != NBUFIO_FD_ERROR);
+
+	err = nbufio_datasync(f_journal_fd);
+	return (err == 0 ? 0 : GATERR_IO_SYNC);
+}
+
+/* once per batch, after all of its files were written */
+/* NOTE: if this is lost in a crash, --recover restores the old tags of the
+     whole batch, which is still consistent
+*/
+/* returns 0 on success */
+GATEPA enum GatepaErr
+journal_batch_done(void)
+/*@globals	fileSystem,
+		internalState,
+		f_journal_fd
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+{
+	int err;
+
+	assert(f_journal_fd != NBUFIO_FD_ERROR);
+
+	err = nbufio_truncate(f_journal_fd, 0);
+	return (err == 0 ? 0 : GATERR_IO_TRUNCATE);
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* restores every old tag in the journal, then removes it; restoring a tag
+     that was never overwritten is harmless, so this may be re-run
+*/
+/* returns 0 on success, <0 on a journal err, or the number of file errs */
+GATEPA int
+journal_recover(void)
+/*@globals	fileSystem,
+		internalState,
+		g_journal
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+{
+	const uint8_t magic[4u] = JOURNAL_REC_MAGIC;
+	/* * */
+	struct Journal_Rec rec;
+	nbufio_fd fd;
+	uint8_t *buf;
+	char *name;
+	off_t size, off_begin, off_end;
+	size_t idx, size_old, name_len;
+	int retval = 0;
+	union {	int		i;
+		size_t		z;
+		enum GatepaErr	gat;
+	} err;
+
+	assert(g_journal.path != NULL);
+
+	/* read the whole journal */
+	fd = nbufio_open(g_journal.path, O_RDWR);
+	if ( fd == NBUFIO_FD_ERROR ){
+		if ( errno == ENOENT ){
+			return 0;	/* nothing to recover */
+		}
+		gatepa_error("%s: '%s'",
+			gatepa_strerror(GATERR_IO_OPEN), g_journal.path
+		);
+		return -1;
+	}
+	err.i = nbufio_lock(fd, LOCK_EX | LOCK_NB);
+	if ( err.i != 0 ){
+		err.gat = GATERR_IO_WRITELOCK;
+		goto journal_err;
+	}
+	size = nbufio_seek(fd, 0, SEEK_END);
+	if ( (size == NBUFIO_OFF_ERROR) || ((uintmax_t) size > SIZE_MAX) ){
+		err.gat = GATERR_IO_SEEK;
+		goto journal_err;
+	}
+	buf = gatepa_alloc_a1((size_t) size, (size_t) 1u);
+	if ( (size != 0) && (buf == NULL) ){
+		err.gat = GATERR_ALLOCATOR;
+		goto journal_err;
+	}
+	err.z = nbufio_pread(fd, buf, (size_t) size, 0);
+	if ( err.z != (size_t) size ){
+		err.gat = (err.z != NBUFIO_RW_ERROR
+			? GATERR_IO_READ_EOF : GATERR_IO_READ
+		);
+		goto journal_err;
+	}
+
+	/* restore each record; a torn last record was never synced, so none
+	     of the batch was written yet
+	*/
+	for ( idx = 0; (size_t) size - idx >= sizeof rec; ){
+		(void) memcpy(&rec, &buf[idx], sizeof rec);
+		if ( memcmp(rec.magic, magic, sizeof magic) != 0 ){
+			err.gat = GATERR_JOURNAL_MALFORMED;
+			goto journal_err;
+		}
+		off_begin = (off_t) byteswap_u64_letoh(rec.off_begin);
+		off_end   = (off_t) byteswap_u64_letoh(rec.off_end);
+		name_len  = (size_t) byteswap_u32_letoh(rec.name_len);
+		if ( (off_begin < 0) || (off_end < off_begin) ){
+			err.gat = GATERR_JOURNAL_MALFORMED;
+			goto journal_err;
+		}
+		size_old = (size_t) (off_end - off_begin);
+		if ( (size_old > (size_t) size - idx - sizeof rec)
+		    ||
+		     (name_len > (size_t) size - idx - sizeof rec - size_old)
+		){
+			break;	/* torn */
+		}
+
+		err.i = gatepa_alloc_scratch_reset();
+		name  = gatepa_alloc_scratch(name_len + 1u, (size_t) 1u);
+		if ( (err.i != 0) || (name == NULL) ){
+			err.gat = GATERR_ALLOCATOR;
+			goto journal_err;
+		}
+		(void) memcpy(
+			name, &buf[idx + sizeof rec + size_old], name_len
+		);
+		name[name_len] = '\0';
+
+		err.gat = journal_restore(
+			name, &buf[idx + sizeof rec], off_begin, off_end
+		);
+		if UNLIKELY ( err.gat != 0 ){
+			gatepa_error("%s: '%s'",
+				gatepa_strerror(err.gat), name
+			);
+			retval += (retval != INT_MAX ? 1 : 0);
+		}
+		idx += sizeof rec + size_old + name_len;
+	}
+
+	/* keep the journal if anything failed, so it can be re-run */
+	if ( retval == 0 ){
+		(void) unlink(g_journal.path);
+	}
+	(void) nbufio_close(fd);
+	return retval;
+
+journal_err:
+	gatepa_error("%s: '%s'", gatepa_strerror(err.gat), g_journal.path);
+	(void) nbufio_close(fd);
+	return -1;
+}
+
+/* writes back the old tag bytes at off_begin, and the old EOF */
+/* returns 0 on success */
+static enum GatepaErr
+journal_restore(
+	const char *const name, const uint8_t *const old,
+	const off_t off_begin, const off_t off_end
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+{
+	const size_t size_old = (size_t) (off_end - off_begin);
+	/* * */
+	nbufio_fd fd;
+	enum GatepaErr retval = 0;
+	union {	int	i;
+		size_t	z;
+	} err;
+
+	fd = nbufio_open(name, O_RDWR);
+	if ( fd == NBUFIO_FD_ERROR ){
+		return GATERR_IO_OPEN;
+	}
+	err.i = nbufio_lock(fd, LOCK_EX | LOCK_NB);
+	if ( err.i != 0 ){
+		retval = GATERR_IO_WRITELOCK;
+		goto close_file;
+	}
+	err.z = nbufio_pwrite(fd, old, size_old, off_begin);
+	if ( err.z != size_old ){
+		retval = GATERR_IO_WRITE;
+		goto close_file;
+	}
+	err.i = nbufio_truncate(fd, off_end);
+	if ( err.i != 0 ){
+		retval = GATERR_IO_TRUNCATE;
+		goto close_file;
+	}
+	err.i = nbufio_datasync(fd);
+	if ( err.i != 0 ){
+		retval = GATERR_IO_SYNC;
+	}
+
+close_file:
+	(void) nbufio_close(fd);
+	return retval;
+}
+
+/* EOF //////////////////////////////////////////////////////////////////// */
@@ -0,0 +1,104 @@
+#ifndef GATEPA_JOURNAL_H
+#define GATEPA_JOURNAL_H
+/* ///////////////////////////////////////////////////////////////////////////
+//                                                                          //
+// journal.h - intent journal for the write modes                           //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+// Copyright (C) 2025, Shane Seelig                                         //
+// SPDX-License-Identifier: GPL-3.0-or-later                                //
+//                                                                          //
+/////////////////////////////////////////////////////////////////////////// */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include <libs/nbufio.h>
+
+#include "apetag.h"
+#include "attributes.h"
+#include "errors.h"
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+struct Journal_Globals {
+	/*@null@*/ /*@observer@*/
+	const char	*path;		/* journal file, NULL for none      */
+	bool		recover;	/* restore the journaled tags       */
+};
+
+/*@checkmod@*/ /*@unused@*/
+extern struct Journal_Globals g_journal;
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+/* a batch is every file that one write mode rewrites in one window:
+	- journal_batch_add() records each file's old tag
+	- journal_batch_sync() makes the records durable before any write
+	- journal_batch_done() empties the journal after the writes
+   so the journal only ever holds the batch being written
+*/
+
+GATEPA_EXTERN enum GatepaErr journal_open(void)
+/*@globals	fileSystem,
+		internalState,
+		g_journal
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+;
+
+GATEPA_EXTERN enum GatepaErr journal_close(void)
+/*@globals	fileSystem,
+		internalState,
+		g_journal
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+;
+
+GATEPA_EXTERN enum GatepaErr journal_batch_add(
+	const char *, nbufio_fd, const struct Gatepa_FileInfo *,
+	/*@null@*/ const uint8_t *
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+;
+
+GATEPA_EXTERN enum GatepaErr journal_batch_sync(void)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+;
+
+GATEPA_EXTERN enum GatepaErr journal_batch_done(void)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+;
+
+GATEPA_EXTERN int journal_recover(void)
+/*@globals	fileSystem,
+		internalState,
+		g_journal
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+;
+
+/* EOF //////////////////////////////////////////////////////////////////// */
+#endif	/* GATEPA_JOURNAL_H */
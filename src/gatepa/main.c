@@ -10,18 +10,23 @@
 /////////////////////////////////////////////////////////////////////////// */
 
 #include <ctype.h>
+#include <stdbool.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include <libs/bitset.h>
 #include <libs/gbitset.h>
 #include <libs/nbufio.h>
 
 #include "alloc.h"
+#include "apetag.h"
 #include "attributes.h"
 #include "errors.h"
 #include "help.h"
+#include "journal.h"
 #include "mode.h"
 #include "open.h"
+#include "stats.h"
 
 /* //////////////////////////////////////////////////////////////////////// */
 
@@ -29,13 +34,22 @@ typedef enum GatepaErr (*gatepa_fnptr_mode)(
 	const char *, char, const struct OpenFiles *, struct GBitset *
 );
 
+typedef enum GatepaErr (*gatepa_fnptr_mode_compile)(
+	struct ModeOp *, const char *, char, const struct OpenFiles *
+);
+
+/* a mode has either fn and check, or compile (see struct ModeOp) */
 struct ModeInfo {
 	/*@temp@*/
-	const char		*name;
-	/*@temp@*/
-	gatepa_fnptr_mode	fn;
-	char			sep;
-	size_t			range_idx;
+	const char			*name;
+	/*@temp@*/ /*@null@*/
+	gatepa_fnptr_mode		fn;
+	/*@temp@*/ /*@null@*/
+	gatepa_fnptr_mode		check;
+	/*@temp@*/ /*@null@*/
+	gatepa_fnptr_mode_compile	compile;
+	char				sep;
+	size_t				range_idx;
 };
 
 /* //////////////////////////////////////////////////////////////////////// */
@@ -72,7 +86,7 @@ const char *f_mode_name[GATEPA_NUM_MODES] = {
 /*@unchecked@*/
 const uint8_t f_mode_name_len[GATEPA_NUM_MODES] = {
 	UINT8_C( 3),	/* add           */
-	UINT8_C( 9),	/* add-file      */
+	UINT8_C( 8),	/* add-file      */
 	UINT8_C( 7),	/* add-loc       */
 	UINT8_C( 6),	/* append        */
 	UINT8_C(10),	/* append-loc    */
@@ -100,33 +114,92 @@ const uint8_t f_mode_name_len[GATEPA_NUM_MODES] = {
 
 /*@unchecked@*/
 static const gatepa_fnptr_mode f_mode_fnptr[GATEPA_NUM_MODES] = {
-	mode_add,
+	NULL,		/* add           */
 	mode_addfile,
-	mode_addloc,
-	mode_append,
-	mode_appendloc,
-	mode_autotrack,
-	mode_clear,
+	NULL,		/* add-loc       */
+	NULL,		/* append        */
+	NULL,		/* append-loc    */
+	NULL,		/* auto-track    */
+	NULL,		/* clear         */
 	mode_dump,
 	mode_extract,
 	mode_print_short,
 	mode_print_long,
 	mode_print_short,
-	mode_remove,
-	mode_rename,
-	mode_sort_audio,
-	mode_sort_alpha,
-	mode_sort_audio,
-	mode_tidykeys_lo,
-	mode_tidykeys_1up,
-	mode_tidykeys_lo,
-	mode_tidykeys_up,
+	NULL,		/* remove        */
+	NULL,		/* rename        */
+	NULL,		/* sort          */
+	NULL,		/* sort-alpha    */
+	NULL,		/* sort-audio    */
+	NULL,		/* tidy-keys     */
+	NULL,		/* tidy-keys-1up */
+	NULL,		/* tidy-keys-lo  */
+	NULL,		/* tidy-keys-up  */
 	mode_verify,
 	mode_write_long,
 	mode_write_long,
 	mode_write_short
 };
 
+/* parses the mode string of a fn mode without running it */
+/*@unchecked@*/
+static const gatepa_fnptr_mode f_mode_check[GATEPA_NUM_MODES] = {
+	NULL,		/* add           */
+	mode_addfile_check,
+	NULL,		/* add-loc       */
+	NULL,		/* append        */
+	NULL,		/* append-loc    */
+	NULL,		/* auto-track    */
+	NULL,		/* clear         */
+	mode_range_check,
+	mode_extract_check,
+	mode_range_check,
+	mode_range_check,
+	mode_range_check,
+	NULL,		/* remove        */
+	NULL,		/* rename        */
+	NULL,		/* sort          */
+	NULL,		/* sort-alpha    */
+	NULL,		/* sort-audio    */
+	NULL,		/* tidy-keys     */
+	NULL,		/* tidy-keys-1up */
+	NULL,		/* tidy-keys-lo  */
+	NULL,		/* tidy-keys-up  */
+	mode_range_check,
+	mode_range_check,
+	mode_range_check,
+	mode_range_check
+};
+
+/*@unchecked@*/
+static const gatepa_fnptr_mode_compile f_mode_compile[GATEPA_NUM_MODES] = {
+	mode_add_compile,
+	NULL,		/* add-file      */
+	mode_addloc_compile,
+	mode_append_compile,
+	mode_appendloc_compile,
+	mode_autotrack_compile,
+	mode_clear_compile,
+	NULL,		/* dump          */
+	NULL,		/* extract       */
+	NULL,		/* print         */
+	NULL,		/* print-long    */
+	NULL,		/* print-short   */
+	mode_remove_compile,
+	mode_rename_compile,
+	mode_sort_audio_compile,
+	mode_sort_alpha_compile,
+	mode_sort_audio_compile,
+	mode_tidykeys_lo_compile,
+	mode_tidykeys_1up_compile,
+	mode_tidykeys_lo_compile,
+	mode_tidykeys_up_compile,
+	NULL,		/* verify        */
+	NULL,		/* write         */
+	NULL,		/* write-long    */
+	NULL		/* write-short   */
+};
+
 /* //////////////////////////////////////////////////////////////////////// */
 
 GATEPA_EXTERN int opt_process(const char *)
@@ -138,8 +211,67 @@ GATEPA_EXTERN int opt_process(const char *)
 @*/
 ;
 
+/*@observer@*/ /*@null@*/
+GATEPA_EXTERN const char *opt_process_env(void)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+;
+
 /* //////////////////////////////////////////////////////////////////////// */
 
+static int check_modes(
+	unsigned int, const char *const *, unsigned int, unsigned int
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	internalState@*/
+;
+
+#undef openfiles
+#undef range_gbs
+static int process_modes(
+	const struct OpenFiles *openfiles, struct GBitset *range_gbs,
+	unsigned int, const char *const *, unsigned int
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState,
+		*range_gbs
+@*/
+;
+
+#undef openfiles
+static int process_ops(
+	const struct OpenFiles *openfiles, const char *const *, unsigned int,
+	unsigned int
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState,
+		openfiles->tag[],
+		openfiles->dirty[]
+@*/
+;
+
+static unsigned int count_ops(unsigned int, const char *const *, unsigned int)
+/*@*/
+;
+
+static bool modes_write_files(
+	unsigned int, const char *const *, unsigned int
+)
+/*@*/
+;
+
 #undef info
 static int scan_mode(/*@out@*/ struct ModeInfo *info, const char *)
 /*@modifies	*info@*/
@@ -175,12 +307,17 @@ main(const int argc, const char *const *const argv)
 @*/
 {
 	struct OpenFiles openfiles;
-	struct ModeInfo  modeinfo;
 	struct GBitset   range_gbs;
+	struct Alloc_Mark window_mark;
 	/* * */
 	unsigned int num_opts = 0, num_files = 0;
 	unsigned int idx_opt0, idx_file0;
+	unsigned int window, idx_base, num_window = 0;
 	unsigned int arg_idx = 1u;
+	uint64_t t_phase;
+	bool writes;
+	/*@observer@*/ /*@null@*/
+	const char *env_name;
 	union {	int		i;
 		enum GatepaErr	gat;
 	} err;
@@ -212,7 +349,12 @@ main(const int argc, const char *const *const argv)
 	/* register the cleanup function (exit() handles closing files) */
 	(void) atexit(gatepa_alloc_destroy);
 
-	/* process each opt */
+	/* process the opts from the environment, then each opt */
+	env_name = opt_process_env();
+	if UNLIKELY ( env_name != NULL ){
+		gatepa_error("%s: bad value", env_name);
+		exit(EXIT_FAILURE);
+	}
 	for ( i = 0; i < num_opts; ++i ){
 		err.i = opt_process(argv[idx_opt0 + i]);
 		if UNLIKELY ( err.i != 0 ){
@@ -223,6 +365,23 @@ main(const int argc, const char *const *const argv)
 		}
 	}
 
+	/* size the arenas */
+	err.i = gatepa_alloc_config();
+	if UNLIKELY ( err.i != 0 ){
+		gatepa_error("%s", gatepa_strerror(GATERR_ALLOCATOR));
+		return EXIT_FAILURE;
+	}
+
+	/* restore the tags of an interrupted journaled run */
+	if ( g_journal.recover ){
+		if UNLIKELY ( g_journal.path == NULL ){
+			gatepa_error("--recover needs a --journal");
+			return EXIT_FAILURE;
+		}
+		err.i = journal_recover();
+		return (err.i == 0 ? EXIT_SUCCESS : EXIT_FAILURE);
+	}
+
 	if UNLIKELY ( num_files == 0 ){
 		gatepa_error("no files");
 		return EXIT_FAILURE;
@@ -235,40 +394,374 @@ main(const int argc, const char *const *const argv)
 		return EXIT_FAILURE;
 	}
 
-	/* open each file */
-	err.i = open_files(&openfiles, num_files, &argv[idx_file0]);
-	if ( err.i != 0 ){
+	/* check every mode before any file is opened or written */
+	err.i = check_modes((unsigned int) argc, argv, arg_idx, num_files);
+	if UNLIKELY ( err.i != 0 ){
 		return EXIT_FAILURE;
 	}
 
-	/* init the range bitset */
+	/* a file being rewritten can't back the tags read from it */
+	writes = modes_write_files((unsigned int) argc, argv, arg_idx);
+	if ( g_open.mmap && writes ){
+		g_open.mmap = false;
+	}
+
+	/* the journal is only needed by the write modes */
+	if ( (g_journal.path != NULL) && writes ){
+		err.gat = journal_open();
+		if UNLIKELY ( err.gat != 0 ){
+			gatepa_error("%s: '%s'",
+				gatepa_strerror(err.gat), g_journal.path
+			);
+			return EXIT_FAILURE;
+		}
+		/* the journal is emptied after each batch, so the files must
+		     be on disk by then
+		*/
+		if ( g_apetag.sync == WRITESYNC_NONE ){
+			g_apetag.sync = WRITESYNC_BATCH;
+		}
+	}
+
+	/* process the files in windows (all of them at once by default), with
+	     each one's memory rolled back after it's closed, so the peak is of
+	     the biggest window rather than of every file
+	*/
+	err.i = gatepa_alloc_mark(&window_mark);
+	if UNLIKELY ( err.i != 0 ){
+		gatepa_error("%s", gatepa_strerror(GATERR_ALLOCATOR));
+		return EXIT_FAILURE;
+	}
+	window = (g_open.window < num_files ? g_open.window : num_files);
+	for ( idx_base = 0; idx_base < num_files; idx_base += num_window ){
+		num_window = (num_files - idx_base < window
+			? num_files - idx_base : window
+		);
+
+		/* open each file */
+		t_phase = stats_clock();
+		err.i   = open_files(
+			&openfiles, num_window, &argv[idx_file0], idx_base,
+			num_files
+		);
+		stats_phase_add(u8"open", t_phase);
+		if ( err.i != 0 ){
+			return EXIT_FAILURE;
+		}
+
+		/* init the range bitset */
+		err.i = gbitset_init(
+			&range_gbs, (uint32_t) num_window, &g_myalloc_gbitset
+		);
+		if UNLIKELY ( err.i != 0 ){
+			gatepa_error("%s", gatepa_strerror(GATERR_ALLOCATOR));
+			return EXIT_FAILURE;
+		}
+
+		/* process each mode */
+		err.i = process_modes(
+			&openfiles, &range_gbs, (unsigned int) argc, argv,
+			arg_idx
+		);
+		if UNLIKELY ( err.i != 0 ){
+			return EXIT_FAILURE;
+		}
+
+		/* close the window, and release its memory */
+		t_phase = stats_clock();
+		err.i   = close_files(&openfiles);
+		if UNLIKELY ( err.i != 0 ){
+			return EXIT_FAILURE;
+		}
+		err.i = gatepa_alloc_rollback(&window_mark);
+		stats_phase_add(u8"close", t_phase);
+		if UNLIKELY ( err.i != 0 ){
+			gatepa_error("%s", gatepa_strerror(GATERR_ALLOCATOR));
+			return EXIT_FAILURE;
+		}
+	}
+	gatepa_alloc_mark_fini(&window_mark);
+
+	err.gat = journal_close();
+	if UNLIKELY ( err.gat != 0 ){
+		gatepa_error("%s: '%s'",
+			gatepa_strerror(err.gat), g_journal.path
+		);
+		return EXIT_FAILURE;
+	}
+
+	return EXIT_SUCCESS;
+}
+
+/* parses every mode string against all of the files (as if in 1 window),
+     so a bad mode is caught before the earlier modes have run; the tag edits
+     are compiled and thrown away, and the other modes are only checked
+*/
+/* returns 0 on success */
+static int
+check_modes(
+	const unsigned int argc, const char *const *const argv,
+	const unsigned int arg_idx, const unsigned int num_files
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	internalState@*/
+{
+	struct OpenFiles plan;
+	struct ModeInfo  modeinfo;
+	struct ModeOp    op;
+	uint8_t *dirty;
+	union {	int		i;
+		enum GatepaErr	gat;
+	} err;
+	unsigned int i;
+
+	dirty = gatepa_alloc_a16(
+		sizeof *dirty, (size_t) BITSET_BYTELEN(num_files)
+	);
 	err.i = gbitset_init(
-		&range_gbs, (uint32_t) num_files, &g_myalloc_gbitset
+		&op.range, (uint32_t) num_files, &g_myalloc_gbitset
 	);
-	if UNLIKELY ( err.i != 0 ){
+	if UNLIKELY ( (dirty == NULL) || (err.i != 0) ){
 		gatepa_error("%s", gatepa_strerror(GATERR_ALLOCATOR));
+		return -1;
 	}
+	(void) memset(dirty, 0x00, (size_t) BITSET_BYTELEN(num_files));
+
+	/* no tags, just the shape of the files */
+	plan = (struct OpenFiles) {
+		NULL, NULL, NULL, NULL, NULL, dirty, NULL,
+		num_files, num_files, 0
+	};
+
+	for ( i = arg_idx; i < argc; ++i ){
+		err.i = scan_mode(&modeinfo, argv[i]);
+		if UNLIKELY ( err.i != 0 ){
+			gatepa_error("argv[%u]: bad mode string", i);
+			return -1;
+		}
+
+		if ( modeinfo.compile != NULL ){
+			err.gat = modeinfo.compile(
+				&op, &argv[i][modeinfo.range_idx],
+				modeinfo.sep, &plan
+			);
+		}
+		else {	assert(modeinfo.check != NULL);
+			err.gat = modeinfo.check(
+				&argv[i][modeinfo.range_idx],
+				modeinfo.sep, &plan, &op.range
+			);
+		}
+		if UNLIKELY ( err.gat != 0 ){
+			gatepa_error("argv[%u] (%s): %s",
+				i, modeinfo.name, gatepa_strerror(err.gat)
+			);
+			return -1;
+		}
+	}
+
+	return 0;
+}
+
+/* returns 0 on success */
+static int
+process_modes(
+	const struct OpenFiles *const openfiles,
+	struct GBitset *const range_gbs,
+	const unsigned int argc, const char *const *const argv,
+	unsigned int arg_idx
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState,
+		*range_gbs
+@*/
+{
+	struct ModeInfo modeinfo;
+	uint64_t t_mode;
+	unsigned int num_ops;
+	union {	int		i;
+		enum GatepaErr	gat;
+	} err;
 
-	/* process each mode */
 	do {	err.i = scan_mode(&modeinfo, argv[arg_idx]);
 		if UNLIKELY ( err.i != 0 ){
 			gatepa_error("argv[%u]: bad mode string", arg_idx);
-			return EXIT_FAILURE;
+			return -1;
+		}
+
+		/* a run of tag edits is done in one pass */
+		if ( modeinfo.compile != NULL ){
+			num_ops = count_ops(argc, argv, arg_idx);
+			t_mode  = stats_clock();
+			err.i   = process_ops(
+				openfiles, argv, arg_idx, num_ops
+			);
+			stats_phase_add(u8"edit", t_mode);
+			if UNLIKELY ( err.i != 0 ){
+				return -1;
+			}
+			arg_idx += num_ops;
+			continue;
 		}
+
+		assert(modeinfo.fn != NULL);
+		t_mode  = stats_clock();
 		err.gat = modeinfo.fn(
 			&argv[arg_idx][modeinfo.range_idx],
-			modeinfo.sep, &openfiles, &range_gbs
+			modeinfo.sep, openfiles, range_gbs
 		);
+		stats_phase_add(modeinfo.name, t_mode);
 		if UNLIKELY ( err.gat != 0 ){
 			gatepa_error("argv[%u] (%s): %s",
 				arg_idx, modeinfo.name,
 				gatepa_strerror(err.gat)
 			);
-			return EXIT_FAILURE;
+			return -1;
 		}
-	} while ( ++arg_idx != (unsigned int) argc );
+		arg_idx += 1u;
+	} while ( arg_idx != argc );
 
-	return EXIT_SUCCESS;
+	return 0;
+}
+
+/* compiles num_ops tag edits, then applies them in order to each tag in
+     turn, so a chain of N edits is 1 pass over the tags instead of N
+*/
+/* returns 0 on success */
+static int
+process_ops(
+	const struct OpenFiles *const openfiles,
+	const char *const *const argv, const unsigned int arg_idx,
+	const unsigned int num_ops
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState,
+		openfiles->tag[],
+		openfiles->dirty[]
+@*/
+{
+	struct ModeInfo modeinfo;
+	struct ModeOp *ops;
+	union {	int		i;
+		enum GatepaErr	gat;
+	} err;
+	size_t idx;
+	unsigned int i;
+	bool changed;
+
+	assert(num_ops != 0);
+
+	ops = gatepa_alloc_a16(sizeof *ops, (size_t) num_ops);
+	if UNLIKELY ( ops == NULL ){
+		gatepa_error("%s", gatepa_strerror(GATERR_ALLOCATOR));
+		return -1;
+	}
+
+	/* compile */
+	for ( i = 0; i < num_ops; ++i ){
+		(void) scan_mode(&modeinfo, argv[arg_idx + i]);
+		assert(modeinfo.compile != NULL);
+
+		err.i = gbitset_init(
+			&ops[i].range, (uint32_t) openfiles->nmemb,
+			&g_myalloc_gbitset
+		);
+		if UNLIKELY ( err.i != 0 ){
+			gatepa_error("%s", gatepa_strerror(GATERR_ALLOCATOR));
+			return -1;
+		}
+		err.gat = modeinfo.compile(
+			&ops[i], &argv[arg_idx + i][modeinfo.range_idx],
+			modeinfo.sep, openfiles
+		);
+		if UNLIKELY ( err.gat != 0 ){
+			gatepa_error("argv[%u] (%s): %s",
+				arg_idx + i, modeinfo.name,
+				gatepa_strerror(err.gat)
+			);
+			return -1;
+		}
+	}
+
+	/* apply */
+	for ( idx = 0; idx < (size_t) openfiles->nmemb; ++idx ){
+		for ( i = 0; i < num_ops; ++i ){
+			if ( bitset_get(GBITSET_PTR(&ops[i].range), idx) == 0 ){
+				continue;
+			}
+			err.gat = ops[i].apply(
+				&openfiles->tag[idx], &ops[i], &changed
+			);
+			if UNLIKELY ( err.gat != 0 ){
+				(void) scan_mode(&modeinfo, argv[arg_idx + i]);
+				gatepa_error("argv[%u] (%s): %s",
+					arg_idx + i, modeinfo.name,
+					gatepa_strerror(err.gat)
+				);
+				return -1;
+			}
+			if ( changed ){
+				(void) bitset_set_1(openfiles->dirty, idx);
+			}
+		}
+	}
+
+	return 0;
+}
+
+/* returns the number of tag edits in a row, from arg_idx */
+static unsigned int
+count_ops(
+	const unsigned int argc, const char *const *const argv,
+	const unsigned int arg_idx
+)
+/*@*/
+{
+	struct ModeInfo modeinfo;
+	unsigned int i;
+	int err;
+
+	for ( i = arg_idx; i < argc; ++i ){
+		err = scan_mode(&modeinfo, argv[i]);
+		if ( (err != 0) || (modeinfo.compile == NULL) ){
+			break;
+		}
+	}
+	return i - arg_idx;
+}
+
+/* returns true if any of the modes writes to the files */
+static bool
+modes_write_files(
+	const unsigned int argc, const char *const *const argv,
+	unsigned int arg_idx
+)
+/*@*/
+{
+	struct ModeInfo modeinfo;
+	int err;
+
+	for ( ; arg_idx < argc; ++arg_idx ){
+		err = scan_mode(&modeinfo, argv[arg_idx]);
+		if ( err != 0 ){
+			continue;	/* check_modes() reports it */
+		}
+		if ( (modeinfo.fn == mode_write_long)
+		    ||
+		     (modeinfo.fn == mode_write_short)
+		){
+			return true;
+		}
+	}
+	return false;
 }
 
 /* returns 0 on success */
@@ -311,6 +804,7 @@ scan_mode(/*@out@*/ struct ModeInfo *const info, const char *const str)
 
 	*info = (struct ModeInfo) {
 		f_mode_name[mode_idx], f_mode_fnptr[mode_idx],
+		f_mode_check[mode_idx], f_mode_compile[mode_idx],
 		sep, sep_idx + 1u
 	};
 	return 0;
@@ -390,10 +884,10 @@ get_mode_idx(const uint8_t *const data, const size_t len)
 /*$20*/	(T) M_ADD_LOC,	(T) -1,		(T) -1,		(T) -1,
 	(T) M_S_ALPHA,	(T) -1,		(T) -1,		(T) M_WRITE_L,
 	(T) -1,		(T) M_WRITE_S,	(T) -1,		(T) M_TIDY,
-	(T) M_APPEND_L,	(T) -1,		(T) -1,		(T) -1,
+	(T) M_APPEND_L,	(T) M_ADD_FILE,	(T) -1,		(T) -1,
 /*$30*/	(T) -1,		(T) M_PRINT_S,	(T) -1,		(T) -1,
 	(T) -1,		(T) -1,		(T) M_TIDY_1U,	(T) M_S_AUDIO,
-	(T) -1,		(T) M_A_TRACK,	(T) -1,		(T) M_ADD_FILE,
+	(T) -1,		(T) M_A_TRACK,	(T) -1,		(T) -1,
 	(T) -1,		(T) -1,		(T) -1,		(T) M_PRINT_L,
 	#undef T
 	};
@@ -11,6 +11,12 @@
 //                                                                          //
 /////////////////////////////////////////////////////////////////////////// */
 
+#include <stdbool.h>
+
+#include <libs/gbitset.h>
+#include <libs/gstring.h>
+
+#include "apetag.h"
 #include "attributes.h"
 #include "errors.h"
 #include "open.h"
@@ -46,6 +52,47 @@ enum ModeIdx {
 };
 #define GATEPA_NUM_MODES	((unsigned int) M_WRITE_S + 1u)
 
+/* ------------------------------------------------------------------------ */
+
+/* the modes that only edit each tag in their range, on its own, get compiled
+     into an op; a run of them is then applied file by file in one pass,
+     instead of one pass over every tag per mode
+*/
+/* an op sets *changed when it really changed the tag, for write/ */
+
+struct ModeOp;
+
+typedef enum GatepaErr (*gatepa_fnptr_modeop)(
+	struct Gatepa_Tag *, struct ModeOp *, /*@out@*/ bool *
+);
+
+struct ModeOp {
+	/*@temp@*/
+	gatepa_fnptr_modeop	apply;		/* to each tag in the range */
+	struct GBitset		range;
+	union {	struct {
+			struct Gatepa_Key	key;
+			struct GString		value;
+			struct Gatepa_Item	item;	/* made on first use */
+			enum ApeFlag_ItemType	type;
+		} add;			/* and append */
+		struct {
+			struct Gatepa_Key	key;
+			unsigned int		pow10;
+			unsigned int		track_curr;
+			unsigned int		track_total;
+		} autotrack;
+		struct Gatepa_Key	remove;
+		struct {
+			struct Gatepa_Key	old_key;
+			struct Gatepa_Key	new_key;
+		} rename;
+		enum Sort_TagCompar	sort;
+		/*@temp@*/
+		bool (*tidykeys)(struct GString *);
+	} arg;
+};
+
 /* //////////////////////////////////////////////////////////////////////// */
 
 NOINLINE PURE
@@ -53,17 +100,12 @@ GATEPA_EXTERN int get_mode_idx(const uint8_t *, size_t) /*@*/;
 
 /* ======================================================================== */
 
-#undef openfiles
-#undef range_gbs
-GATEPA_EXTERN enum GatepaErr mode_add(
-	const char *, char, const struct OpenFiles *openfiles,
-	struct GBitset *range_gbs
+#undef op
+GATEPA_EXTERN enum GatepaErr mode_add_compile(
+	/*@out@*/ struct ModeOp *op, const char *, char,
+	const struct OpenFiles *
 )
-/*@globals	internalState@*/
-/*@modifies	internalState,
-		openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 ;
 
 #undef openfiles
@@ -83,70 +125,79 @@ GATEPA_EXTERN enum GatepaErr mode_addfile(
 
 #undef openfiles
 #undef range_gbs
-GATEPA_EXTERN enum GatepaErr mode_addloc(
+GATEPA_EXTERN enum GatepaErr mode_addfile_check(
 	const char *, char, const struct OpenFiles *openfiles,
 	struct GBitset *range_gbs
 )
-/*@globals	internalState@*/
+/*@globals	fileSystem,
+		internalState
+@*/
 /*@modifies	internalState,
-		openfiles->tag[],
 		*range_gbs
 @*/
 ;
 
-#undef openfiles
-#undef range_gbs
-GATEPA_EXTERN enum GatepaErr mode_append(
-	const char *, char, const struct OpenFiles *openfiles,
-	struct GBitset *range_gbs
+#undef op
+GATEPA_EXTERN enum GatepaErr mode_addloc_compile(
+	/*@out@*/ struct ModeOp *op, const char *, char,
+	const struct OpenFiles *
 )
-/*@globals	internalState@*/
-/*@modifies	internalState,
-		openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 ;
 
-#undef openfiles
-#undef range_gbs
-GATEPA_EXTERN enum GatepaErr mode_appendloc(
-	const char *, char, const struct OpenFiles *openfiles,
-	struct GBitset *range_gbs
+#undef op
+GATEPA_EXTERN enum GatepaErr mode_append_compile(
+	/*@out@*/ struct ModeOp *op, const char *, char,
+	const struct OpenFiles *
 )
-/*@globals	internalState@*/
-/*@modifies	internalState,
-		openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 ;
 
-#undef openfiles
-#undef range_gbs
-GATEPA_EXTERN enum GatepaErr mode_autotrack(
-	const char *, char, const struct OpenFiles *openfiles,
-	struct GBitset *range_gbs
+#undef op
+GATEPA_EXTERN enum GatepaErr mode_appendloc_compile(
+	/*@out@*/ struct ModeOp *op, const char *, char,
+	const struct OpenFiles *
+)
+/*@modifies	*op@*/
+;
+
+#undef op
+GATEPA_EXTERN enum GatepaErr mode_autotrack_compile(
+	/*@out@*/ struct ModeOp *op, const char *, char,
+	const struct OpenFiles *
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
-		openfiles->tag[],
-		*range_gbs
+		*op
 @*/
 ;
 
+#undef op
+GATEPA_EXTERN enum GatepaErr mode_clear_compile(
+	/*@out@*/ struct ModeOp *op, const char *, char,
+	const struct OpenFiles *
+)
+/*@modifies	*op@*/
+;
+
 #undef openfiles
 #undef range_gbs
-GATEPA_EXTERN enum GatepaErr mode_clear(
+GATEPA_EXTERN enum GatepaErr mode_dump(
 	const char *, char, const struct OpenFiles *openfiles,
 	struct GBitset *range_gbs
 )
-/*@modifies	openfiles->tag[],
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState,
 		*range_gbs
 @*/
 ;
 
 #undef openfiles
 #undef range_gbs
-GATEPA_EXTERN enum GatepaErr mode_dump(
+GATEPA_EXTERN enum GatepaErr mode_extract(
 	const char *, char, const struct OpenFiles *openfiles,
 	struct GBitset *range_gbs
 )
@@ -155,19 +206,19 @@ GATEPA_EXTERN enum GatepaErr mode_dump(
 @*/
 /*@modifies	fileSystem,
 		internalState,
+		openfiles->tag[],
 		*range_gbs
 @*/
 ;
 
 #undef openfiles
 #undef range_gbs
-GATEPA_EXTERN enum GatepaErr mode_extract(
+GATEPA_EXTERN enum GatepaErr mode_extract_check(
 	const char *, char, const struct OpenFiles *openfiles,
 	struct GBitset *range_gbs
 )
-/*@globals	fileSystem@*/
-/*@modifies	fileSystem,
-		openfiles->tag[],
+/*@globals	internalState@*/
+/*@modifies	internalState,
 		*range_gbs
 @*/
 ;
@@ -194,85 +245,68 @@ GATEPA_EXTERN enum GatepaErr mode_print_short(
 @*/
 ;
 
-#undef openfiles
 #undef range_gbs
-GATEPA_EXTERN enum GatepaErr mode_remove(
-	const char *, char, const struct OpenFiles *openfiles,
+GATEPA_EXTERN enum GatepaErr mode_range_check(
+	const char *, char, const struct OpenFiles *,
 	struct GBitset *range_gbs
 )
-/*@modifies	openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*range_gbs@*/
 ;
 
-#undef openfiles
-#undef range_gbs
-GATEPA_EXTERN enum GatepaErr mode_rename(
-	const char *, char, const struct OpenFiles *openfiles,
-	struct GBitset *range_gbs
+#undef op
+GATEPA_EXTERN enum GatepaErr mode_remove_compile(
+	/*@out@*/ struct ModeOp *op, const char *, char,
+	const struct OpenFiles *
 )
-/*@modifies	openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 ;
 
-#undef openfiles
-#undef range_gbs
-GATEPA_EXTERN enum GatepaErr mode_sort_alpha(
-	const char *, char, const struct OpenFiles *openfiles,
-	struct GBitset *range_gbs
+#undef op
+GATEPA_EXTERN enum GatepaErr mode_rename_compile(
+	/*@out@*/ struct ModeOp *op, const char *, char,
+	const struct OpenFiles *
 )
-/*@globals	internalState@*/
-/*@modifies	internalState,
-		openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 ;
 
-#undef openfiles
-#undef range_gbs
-GATEPA_EXTERN enum GatepaErr mode_sort_audio(
-	const char *, char, const struct OpenFiles *openfiles,
-	struct GBitset *range_gbs
+#undef op
+GATEPA_EXTERN enum GatepaErr mode_sort_alpha_compile(
+	/*@out@*/ struct ModeOp *op, const char *, char,
+	const struct OpenFiles *
 )
-/*@globals	internalState@*/
-/*@modifies	internalState,
-		openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 ;
 
-#undef openfiles
-#undef range_gbs
-GATEPA_EXTERN enum GatepaErr mode_tidykeys_1up(
-	const char *, char, const struct OpenFiles *openfiles,
-	struct GBitset *range_gbs
+#undef op
+GATEPA_EXTERN enum GatepaErr mode_sort_audio_compile(
+	/*@out@*/ struct ModeOp *op, const char *, char,
+	const struct OpenFiles *
 )
-/*@modifies	openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 ;
 
-#undef openfiles
-#undef range_gbs
-GATEPA_EXTERN enum GatepaErr mode_tidykeys_lo(
-	const char *, char, const struct OpenFiles *openfiles,
-	struct GBitset *range_gbs
+#undef op
+GATEPA_EXTERN enum GatepaErr mode_tidykeys_1up_compile(
+	/*@out@*/ struct ModeOp *op, const char *, char,
+	const struct OpenFiles *
 )
-/*@modifies	openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 ;
 
-#undef openfiles
-#undef range_gbs
-GATEPA_EXTERN enum GatepaErr mode_tidykeys_up(
-	const char *, char, const struct OpenFiles *openfiles,
-	struct GBitset *range_gbs
+#undef op
+GATEPA_EXTERN enum GatepaErr mode_tidykeys_lo_compile(
+	/*@out@*/ struct ModeOp *op, const char *, char,
+	const struct OpenFiles *
 )
-/*@modifies	openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
+;
+
+#undef op
+GATEPA_EXTERN enum GatepaErr mode_tidykeys_up_compile(
+	/*@out@*/ struct ModeOp *op, const char *, char,
+	const struct OpenFiles *
+)
+/*@modifies	*op@*/
 ;
 
 #undef openfiles
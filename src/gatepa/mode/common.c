@@ -26,6 +26,8 @@
 #include "../alloc.h"
 #include "../attributes.h"
 #include "../errors.h"
+#include "../mode.h"
+#include "../open.h"
 #include "../text.h"
 
 #include "common.h"
@@ -55,6 +57,17 @@ struct RangeItem {
 NOINLINE PURE
 static size_t sep_count(const char *, size_t, char) /*@*/;
 
+#undef bitset
+#undef range_len_out
+static enum GatepaErr range_fill(
+	uint8_t *bitset, size_t, /*@out@*/ /*@null@*/ size_t *range_len_out,
+	const char *, size_t, char, unsigned int, unsigned int
+)
+/*@modifies	*bitset,
+		*range_len_out
+@*/
+;
+
 #undef range_gbs
 #undef size_read
 static enum GatepaErr arg_range_get_item(
@@ -76,6 +89,34 @@ static enum GatepaErr get_strtoi(/*@out@*/ unsigned int *value, const char *)
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+/* checks the mode string of a mode that only takes a range (dump, print,
+     verify, write) without running it
+*/
+/* returns 0 on success */
+GATEPA enum GatepaErr
+mode_range_check(
+	const char *const arg_str, const char arg_sep,
+	const struct OpenFiles *const openfiles,
+	struct GBitset *const range_gbs
+)
+/*@modifies	*range_gbs@*/
+{
+	const size_t       arg_len   = strlen(arg_str);
+	const unsigned int num_files = openfiles->nmemb_total;
+	/* * */
+	union {	int		i;
+		enum GatepaErr	gat;
+	} err;
+
+	MODE_SEP_COUNT((size_t) 1u);
+
+	MODE_RANGE_GET(range_gbs, NULL);
+
+	return 0;
+}
+
+/* ======================================================================== */
+
 /* returns 0 on success */
 NOINLINE
 GATEPA enum GatepaErr
@@ -115,6 +156,9 @@ sep_count(
 	return count;
 }
 
+/* only the part of the range within the current window of files,
+     [idx_base, idx_base + range_gbs->bitlen), is set in the bitset
+*/
 /* returns 0 on success */
 NOINLINE
 GATEPA enum GatepaErr
@@ -122,15 +166,112 @@ arg_range_get(
 	struct GBitset *const range_gbs,
 	/*@out@*/ /*@null@*/ size_t *const range_len_out,
 	const char *const arg_str, const size_t arg_len, const char arg_sep,
-	const unsigned int num_files
+	const unsigned int num_files, const unsigned int idx_base
 )
 /*@modifies	*range_gbs,
 		range_len_out
 @*/
+{
+	return range_fill(
+		GBITSET_PTR(range_gbs), (size_t) range_gbs->bitlen,
+		range_len_out, arg_str, arg_len, arg_sep, num_files, idx_base
+	);
+}
+
+/* counts the range over every file, not just those in the current window */
+/* returns 0 on success */
+NOINLINE
+GATEPA enum GatepaErr
+arg_range_count(
+	/*@out@*/ size_t *const nmemb_before_out,
+	/*@out@*/ size_t *const nmemb_total_out,
+	const struct GBitset *const range_gbs,
+	const char *const arg_str, const size_t arg_len, const char arg_sep,
+	const unsigned int num_files, const unsigned int idx_base
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*nmemb_before_out,
+		*nmemb_total_out
+@*/
+{
+	uint8_t *bitset;
+	enum GatepaErr err;
+
+	/* the whole range is already in the bitset */
+	if ( (idx_base == 0) && (range_gbs->bitlen == num_files) ){
+		*nmemb_before_out = 0;
+		*nmemb_total_out  = bitset_popcount(
+			GBITSET_PTR(range_gbs), range_gbs->bitlen
+		);
+		return 0;
+	}
+
+	bitset = gatepa_alloc_scratch(
+		(size_t) 1u, (size_t) BITSET_BYTELEN(num_files)
+	);
+	if ( bitset == NULL ){
+		/*@-mustdefine@*/ /*@-mustmod@*/
+		return GATERR_ALLOCATOR;
+		/*@=mustdefine@*/ /*@=mustmod@*/
+	}
+	memset(bitset, 0x00, (size_t) BITSET_BYTELEN(num_files));
+
+	err = range_fill(
+		bitset, (size_t) num_files, NULL, arg_str, arg_len, arg_sep,
+		num_files, 0
+	);
+	if ( err != 0 ){
+		/*@-mustdefine@*/ /*@-mustmod@*/
+		return err;
+		/*@=mustdefine@*/ /*@=mustmod@*/
+	}
+
+	*nmemb_total_out  = bitset_popcount(bitset, (size_t) num_files);
+	bitset_set_range_0(bitset, (size_t) idx_base, (size_t) num_files - 1u);
+	*nmemb_before_out = bitset_popcount(bitset, (size_t) num_files);
+	return 0;
+}
+
+/* marks every tag of the window that is in the range as changed, so that
+     write/ rewrites it
+*/
+GATEPA void
+range_mark_dirty(
+	uint8_t *const dirty, const struct GBitset *const range_gbs,
+	const unsigned int num_files
+)
+/*@modifies	*dirty@*/
+{
+	const uint8_t *const range = GBITSET_PTR(range_gbs);
+	const size_t         len   = BITSET_BYTELEN(num_files);
+	/* * */
+	size_t i;
+
+	assert(num_files <= range_gbs->bitlen);
+
+	for ( i = 0; i < len; ++i ){
+		dirty[i] |= range[i];
+	}
+	return;
+}
+
+/* returns 0 on success */
+static enum GatepaErr
+range_fill(
+	uint8_t *const bitset, const size_t bitlen,
+	/*@out@*/ /*@null@*/ size_t *const range_len_out,
+	const char *const arg_str, const size_t arg_len, const char arg_sep,
+	const unsigned int num_files, const unsigned int idx_base
+)
+/*@modifies	*bitset,
+		*range_len_out
+@*/
 {
 	struct RangeItem item;
 	size_t range_len, range_nmemb, range_idx;
 	size_t size_read;
+	size_t first, last;
 	void *temp_ptr;
 	union {	int		i;
 		enum GatepaErr	gat;
@@ -138,7 +279,7 @@ arg_range_get(
 	size_t i;
 
 	/* clear the bitset */
-	bitset_set_range_0(GBITSET_PTR(range_gbs), 0, range_gbs->bitlen - 1u);
+	bitset_set_range_0(bitset, 0, bitlen - 1u);
 
 	/* get the total length and nmemb of the range string */
 	temp_ptr = memchr(arg_str, (int) arg_sep, arg_len);
@@ -182,10 +323,23 @@ arg_range_get(
 		       &&
 		        (item.first <= item.last)
 		);
-		bitset_set_range_1(
-			GBITSET_PTR(range_gbs),
-			(size_t) (item.first - 1u), (size_t) (item.last - 1u)
+
+		/* clip to the window */
+		first = (size_t) (item.first - 1u);
+		last  = (size_t) (item.last  - 1u);
+		if ( (last < (size_t) idx_base)
+		    ||
+		     (first >= (size_t) idx_base + bitlen)
+		){
+			continue;
+		}
+		first = (first > (size_t) idx_base
+			? first - (size_t) idx_base : 0
 		);
+		last -= (size_t) idx_base;
+		last  = (last < bitlen ? last : bitlen - 1u);
+
+		bitset_set_range_1(bitset, first, last);
 	}
 	if ( range_len != range_idx - 1u ){
 		/*@-mustdefine@*/ /*@-mustmod@*/
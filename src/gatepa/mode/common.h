@@ -33,7 +33,7 @@
 #define MODE_RANGE_GET(x_gbs_ptr, x_size_read_ptr)	do { \
 	err.gat = arg_range_get( \
 		(x_gbs_ptr), (x_size_read_ptr), arg_str, arg_len, arg_sep, \
-		num_files \
+		num_files, openfiles->idx_base \
 	); \
 	if ( err.gat != 0 ){ \
 		/*@-mustmod@*/ \
@@ -42,6 +42,22 @@
 	} \
 } while ( /*@-predboolptr@*/ 0 /*@=predboolptr@*/ );
 
+#define MODE_RANGE_COUNT(x_gbs_ptr, x_before_ptr, x_total_ptr)	do { \
+	err.gat = arg_range_count( \
+		(x_before_ptr), (x_total_ptr), (x_gbs_ptr), \
+		arg_str, arg_len, arg_sep, num_files, openfiles->idx_base \
+	); \
+	if ( err.gat != 0 ){ \
+		/*@-mustmod@*/ \
+		return err.gat; \
+		/*@=mustmod@*/ \
+	} \
+} while ( /*@-predboolptr@*/ 0 /*@=predboolptr@*/ );
+
+#define MODE_MARK_DIRTY(x_gbs_ptr)	do { \
+	range_mark_dirty(openfiles->dirty, (x_gbs_ptr), openfiles->nmemb); \
+} while ( /*@-predboolptr@*/ 0 /*@=predboolptr@*/ );
+
 #define MODE_KEY_GET(x_key_ptr)		do { \
 	err.gat = arg_key_get( \
 		(x_key_ptr), &arg_str[arg_idx], arg_len - arg_idx, arg_sep \
@@ -98,13 +114,36 @@ GATEPA_EXTERN enum GatepaErr arg_sep_count(const char *, size_t, char, size_t)
 NOINLINE
 GATEPA_EXTERN enum GatepaErr arg_range_get(
 	struct GBitset *range_gbs, /*@out@*/ /*@null@*/ size_t *range_len_out,
-	const char *, size_t, char, unsigned int
+	const char *, size_t, char, unsigned int, unsigned int
 )
 /*@modifies	*range_gbs,
 		*range_len_out
 @*/
 ;
 
+#undef nmemb_before_out
+#undef nmemb_total_out
+#undef range_gbs
+NOINLINE
+GATEPA_EXTERN enum GatepaErr arg_range_count(
+	/*@out@*/ size_t *nmemb_before_out, /*@out@*/ size_t *nmemb_total_out,
+	const struct GBitset *range_gbs,
+	const char *, size_t, char, unsigned int, unsigned int
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*nmemb_before_out,
+		*nmemb_total_out
+@*/
+;
+
+#undef dirty
+GATEPA_EXTERN void range_mark_dirty(
+	uint8_t *dirty, const struct GBitset *, unsigned int
+)
+/*@modifies	*dirty@*/
+;
+
 #undef key
 NOINLINE
 GATEPA_EXTERN enum GatepaErr arg_key_get(
@@ -32,6 +32,23 @@
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+#undef memkey
+#undef path
+#undef openfiles
+#undef range_gbs
+static enum GatepaErr addfile_parse(
+	/*@out@*/ struct Gatepa_Key *memkey, /*@out@*/ char **path,
+	const char *, char, const struct OpenFiles *openfiles,
+	struct GBitset *range_gbs
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*memkey,
+		*path,
+		*range_gbs
+@*/
+;
+
 #undef item
 static enum GatepaErr addfile_item_construct(
 	/*@out@*/ struct Gatepa_Item *item, const char *
@@ -57,7 +74,7 @@ static enum GatepaErr addfile_ext_get(
 #undef tag
 static enum GatepaErr addfile_single(
 	struct Gatepa_Tag *tag, struct Gatepa_Item *item,
-	const struct GString *
+	const struct Gatepa_Key *
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
@@ -82,19 +99,113 @@ mode_addfile(
 		openfiles->tag[],
 		*range_gbs
 @*/
+{
+	struct Gatepa_Key memkey;
+	struct Gatepa_Item item;
+	char *path = NULL;
+	/* * */
+	enum GatepaErr err;
+	size_t idx;
+
+	err = addfile_parse(
+		&memkey, &path, arg_str, arg_sep, openfiles, range_gbs
+	);
+	if ( err != 0 ){
+		/*@-mustdefine@*/ /*@-mustmod@*/
+		return err;
+		/*@=mustdefine@*/ /*@=mustmod@*/
+	}
+	MODE_MARK_DIRTY(range_gbs);
+
+	err = addfile_item_construct(&item, path);
+	if ( err != 0 ){
+		/*@-mustdefine@*/ /*@-mustmod@*/
+		return err;
+		/*@=mustdefine@*/ /*@=mustmod@*/
+	}
+
+	/* add/replace the item in each tag */
+	idx = 0;
+	goto loop_entr;
+	do {	err = addfile_single(&openfiles->tag[idx], &item, &memkey);
+		if ( err != 0 ){
+			return err;
+		}
+		idx += 1u;
+loop_entr:
+		idx  = bitset_find_1(
+			GBITSET_PTR(range_gbs), range_gbs->bitlen, idx
+		);
+	} while ( idx != SIZE_MAX );
+
+	return 0;
+}
+
+/* parses the mode string, and checks that the file can be opened, without
+     reading it or touching any tag
+*/
+/* returns 0 on success */
+GATEPA enum GatepaErr
+mode_addfile_check(
+	const char *const arg_str, const char arg_sep,
+	const struct OpenFiles *const openfiles,
+	struct GBitset *const range_gbs
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	internalState,
+		*range_gbs
+@*/
+{
+	struct Gatepa_Key memkey;
+	char *path = NULL;
+	nbufio_fd fd;
+	enum GatepaErr err;
+
+	err = addfile_parse(
+		&memkey, &path, arg_str, arg_sep, openfiles, range_gbs
+	);
+	if ( err != 0 ){
+		return err;
+	}
+
+	err = open_file(&fd, path);
+	if ( err != 0 ){
+		return err;
+	}
+	(void) nbufio_close(fd);
+
+	return 0;
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* *path is in the scratch arena */
+/* returns 0 on success */
+static enum GatepaErr
+addfile_parse(
+	/*@out@*/ struct Gatepa_Key *const memkey, /*@out@*/ char **const path,
+	const char *const arg_str, const char arg_sep,
+	const struct OpenFiles *const openfiles,
+	struct GBitset *const range_gbs
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*memkey,
+		*path,
+		*range_gbs
+@*/
 {
 	const size_t       arg_len   = strlen(arg_str);
-	const unsigned int num_files = openfiles->nmemb;
+	const unsigned int num_files = openfiles->nmemb_total;
 	/* * */
 	struct GString key;
-	struct Gatepa_Item item;
-	char *path = NULL;
 	/* * */
 	size_t arg_idx, size_read;
 	union {	int		i;
 		enum GatepaErr	gat;
 	} err;
-	size_t idx;
 
 	if ( arg_sep == (char) FILE_PATH_SEP ){
 		/*@-mustdefine@*/ /*@-mustmod@*/
@@ -115,30 +226,10 @@ mode_addfile(
 	arg_idx  = size_read;
 
 	MODE_KEY_GET(&key);
+	apetag_memkey_make(memkey, &key);
 	arg_idx += key.len + 1u;
 
-	MODE_PATH_GET(&path);
-
-	err.gat = addfile_item_construct(&item, path);
-	if ( err.gat != 0 ){
-		/*@-mustdefine@*/ /*@-mustmod@*/
-		return err.gat;
-		/*@=mustdefine@*/ /*@=mustmod@*/
-	}
-
-	/* add/replace the item in each tag */
-	idx = 0;
-	goto loop_entr;
-	do {	err.gat = addfile_single(&openfiles->tag[idx], &item, &key);
-		if ( err.gat != 0 ){
-			return err.gat;
-		}
-		idx += 1u;
-loop_entr:
-		idx  = bitset_find_1(
-			GBITSET_PTR(range_gbs), range_gbs->bitlen, idx
-		);
-	} while ( idx != SIZE_MAX );
+	MODE_PATH_GET(path);
 
 	return 0;
 }
@@ -280,7 +371,7 @@ addfile_ext_get(
 static enum GatepaErr
 addfile_single(
 	struct Gatepa_Tag *const tag, struct Gatepa_Item *const item,
-	const struct GString *const key
+	const struct Gatepa_Key *const key
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
@@ -9,10 +9,10 @@
 //                                                                          //
 /////////////////////////////////////////////////////////////////////////// */
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 
-#include <libs/bitset.h>
 #include <libs/gbitset.h>
 #include <libs/gstring.h>
 
@@ -30,23 +30,33 @@
 
 /* //////////////////////////////////////////////////////////////////////// */
 
-#undef openfiles
-#undef range_gbs
-static enum GatepaErr append_body(
-	const char *, char, const struct OpenFiles *openfiles,
-	struct GBitset *range_gbs, enum ApeFlag_ItemType
+#undef op
+static enum GatepaErr append_compile(
+	/*@out@*/ struct ModeOp *op, const char *, char,
+	const struct OpenFiles *, enum ApeFlag_ItemType
+)
+/*@modifies	*op@*/
+;
+
+#undef tag
+#undef op
+#undef changed
+static enum GatepaErr append_apply(
+	struct Gatepa_Tag *tag, struct ModeOp *op, /*@out@*/ bool *changed
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
-		openfiles->tag[],
-		*range_gbs
+		*tag,
+		*op,
+		*changed
 @*/
 ;
 
 #undef tag
 static enum GatepaErr append_single(
 	struct Gatepa_Tag *tag, struct Gatepa_Item *item,
-	const struct GString *, const struct GString *, enum ApeFlag_ItemType
+	const struct Gatepa_Key *, const struct GString *,
+	enum ApeFlag_ItemType
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
@@ -59,105 +69,97 @@ static enum GatepaErr append_single(
 
 /* returns 0 on success */
 GATEPA enum GatepaErr
-mode_append(
-	const char *const arg_str, const char arg_sep,
-	const struct OpenFiles *const openfiles,
-	struct GBitset *const range_gbs
+mode_append_compile(
+	/*@out@*/ struct ModeOp *const op, const char *const arg_str,
+	const char arg_sep, const struct OpenFiles *const openfiles
 )
-/*@globals	internalState@*/
-/*@modifies	internalState,
-		openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 {
-	return append_body(
-		arg_str, arg_sep, openfiles, range_gbs, APEFLAG_ITEMTYPE_TEXT
+	return append_compile(
+		op, arg_str, arg_sep, openfiles, APEFLAG_ITEMTYPE_TEXT
 	);
 }
 
 /* returns 0 on success */
 GATEPA enum GatepaErr
-mode_appendloc(
-	const char *const arg_str, const char arg_sep,
-	const struct OpenFiles *const openfiles,
-	struct GBitset *const range_gbs
+mode_appendloc_compile(
+	/*@out@*/ struct ModeOp *const op, const char *const arg_str,
+	const char arg_sep, const struct OpenFiles *const openfiles
 )
-/*@globals	internalState@*/
-/*@modifies	internalState,
-		openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 {
-	return append_body(
-		arg_str, arg_sep, openfiles, range_gbs,
-		APEFLAG_ITEMTYPE_LOCATOR
+	return append_compile(
+		op, arg_str, arg_sep, openfiles, APEFLAG_ITEMTYPE_LOCATOR
 	);
 }
 
 /* ------------------------------------------------------------------------ */
 
 /* add/append a text item to tag(s) */
+/* op->range is already init'd */
 /* returns 0 on success */
-GATEPA enum GatepaErr
-append_body(
-	const char *const arg_str, const char arg_sep,
-	const struct OpenFiles *const openfiles,
-	struct GBitset *const range_gbs, const enum ApeFlag_ItemType type
+static enum GatepaErr
+append_compile(
+	/*@out@*/ struct ModeOp *const op, const char *const arg_str,
+	const char arg_sep, const struct OpenFiles *const openfiles,
+	const enum ApeFlag_ItemType type
 )
-/*@globals	internalState@*/
-/*@modifies	internalState,
-		openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 {
 	const size_t       arg_len   = strlen(arg_str);
-	const unsigned int num_files = openfiles->nmemb;
+	const unsigned int num_files = openfiles->nmemb_total;
 	/* * */
-	struct Gatepa_Item item = gatepa_memitem_init(type);
 	struct GString key;
-	struct GString value;
 	/* * */
 	size_t arg_idx, size_read;
 	union {	int		i;
 		enum GatepaErr	gat;
 	} err;
-	size_t idx;
 
 	MODE_SEP_COUNT(MODE_APPEND_NFIELDS);
 
-	MODE_RANGE_GET(range_gbs, &size_read);
+	MODE_RANGE_GET(&op->range, &size_read);
 	arg_idx  = size_read;
 
 	MODE_KEY_GET(&key);
+	apetag_memkey_make(&op->arg.add.key, &key);
 	arg_idx += key.len + 1u;
 
-	MODE_VALUE_GET(&value);
-
-	/* add/replace the item in each tag */
-	idx = 0;
-	goto loop_entr;
-	do {	err.gat = append_single(
-			&openfiles->tag[idx], &item, &key, &value, type
-		);
-		if ( err.gat != 0 ){
-			return err.gat;
-		}
-		idx += 1u;
-loop_entr:
-		idx  = bitset_find_1(
-			GBITSET_PTR(range_gbs), range_gbs->bitlen, idx
-		);
-	} while ( idx != SIZE_MAX );
+	MODE_VALUE_GET(&op->arg.add.value);
 
+	op->arg.add.item = gatepa_memitem_init(type);
+	op->arg.add.type = type;
+	op->apply        = append_apply;
 	return 0;
 }
 
+/* returns 0 on success */
+static enum GatepaErr
+append_apply(
+	struct Gatepa_Tag *const tag, struct ModeOp *const op,
+	/*@out@*/ bool *const changed
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*tag,
+		*op,
+		*changed
+@*/
+{
+	/* an append always adds a value */
+	*changed = true;
+	return append_single(
+		tag, &op->arg.add.item, &op->arg.add.key, &op->arg.add.value,
+		op->arg.add.type
+	);
+}
+
 /* returns 0 on success */
 static enum GatepaErr
 append_single(
 	struct Gatepa_Tag *const tag, struct Gatepa_Item *const item,
-	const struct GString *const key, const struct GString *const value,
-	const enum ApeFlag_ItemType type
+	const struct Gatepa_Key *const key,
+	const struct GString *const value, const enum ApeFlag_ItemType type
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
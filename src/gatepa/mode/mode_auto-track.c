@@ -9,12 +9,12 @@
 //                                                                          //
 /////////////////////////////////////////////////////////////////////////// */
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <string.h>
 
 #include <libs/ascii-literals.h>
-#include <libs/bitset.h>
 #include <libs/gbitset.h>
 #include <libs/gstring.h>
 
@@ -38,90 +38,119 @@
 /* //////////////////////////////////////////////////////////////////////// */
 
 #undef tag
+#undef op
+#undef changed
+static enum GatepaErr autotrack_apply(
+	struct Gatepa_Tag *tag, struct ModeOp *op, /*@out@*/ bool *changed
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*tag,
+		op->arg.autotrack.track_curr,
+		*changed
+@*/
+;
+
+#undef tag
+#undef changed
 static enum GatepaErr
 autotrack_single(
-	struct Gatepa_Tag *tag, unsigned int, unsigned int, unsigned int
+	struct Gatepa_Tag *tag, const struct Gatepa_Key *, unsigned int,
+	unsigned int, unsigned int, /*@out@*/ bool *changed
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
-		*tag
+		*tag,
+		*changed
 @*/
 ;
 
 /* //////////////////////////////////////////////////////////////////////// */
 
 /* add the track number(s) to a group of tag(s) */
+/* op->range is already init'd */
 /* returns 0 on success */
 GATEPA enum GatepaErr
-mode_autotrack(
-	const char *const arg_str, const char arg_sep,
-	const struct OpenFiles *const openfiles,
-	struct GBitset *const range_gbs
+mode_autotrack_compile(
+	/*@out@*/ struct ModeOp *const op, const char *const arg_str,
+	const char arg_sep, const struct OpenFiles *const openfiles
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
-		openfiles->tag[],
-		*range_gbs
+		*op
 @*/
 {
 	const size_t       arg_len   = strlen(arg_str);
-	const unsigned int num_files = openfiles->nmemb;
+	const unsigned int num_files = openfiles->nmemb_total;
+	const struct GString key = {
+		{ASCII_T_LO, ASCII_R_LO, ASCII_A_LO, ASCII_C_LO,
+		 ASCII_K_LO, 0,0,0 ,0,0,0,0
+		},
+		(uint32_t) 5u
+	};
 	/* * */
-	unsigned int track_total, track_curr, pow10;
 	union {	int		i;
 		enum GatepaErr	gat;
 	} err;
-	size_t idx;
+	size_t nmemb_before, nmemb_total;
 
 	MODE_SEP_COUNT(MODE_AUTOTRACK_NFIELDS);
 
-	MODE_RANGE_GET(range_gbs, NULL);
+	MODE_RANGE_GET(&op->range, NULL);
 
-	/* autotrack each tag */
-	track_total = (unsigned int) bitset_popcount(
-		GBITSET_PTR(range_gbs), range_gbs->bitlen
-	);
-	pow10       = ilog10p1((uintmax_t) track_total);
-	track_curr  = 1u;
-	idx = 0;
-	goto loop_entr;
-	do {	err.gat = autotrack_single(
-			&openfiles->tag[idx], pow10, track_curr, track_total
-		);
-		if ( err.gat != 0 ){
-			return err.gat;
-		}
-		track_curr += 1u;
-		idx += 1u;
-loop_entr:
-		idx  = bitset_find_1(
-			GBITSET_PTR(range_gbs), range_gbs->bitlen, idx
-		);
-	} while ( idx != SIZE_MAX );
+	apetag_memkey_make(&op->arg.autotrack.key, &key);
 
+	/* numbered over the whole range, not the window */
+	MODE_RANGE_COUNT(&op->range, &nmemb_before, &nmemb_total);
+	op->arg.autotrack.track_total = (unsigned int) nmemb_total;
+	op->arg.autotrack.pow10       = ilog10p1((uintmax_t) nmemb_total);
+	op->arg.autotrack.track_curr  = (unsigned int) nmemb_before + 1u;
+
+	op->apply = autotrack_apply;
 	return 0;
 }
 
+/* the tags are applied to in order, so each gets the next track number */
+/* returns 0 on success */
+static enum GatepaErr
+autotrack_apply(
+	struct Gatepa_Tag *const tag, struct ModeOp *const op,
+	/*@out@*/ bool *const changed
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*tag,
+		op->arg.autotrack.track_curr,
+		*changed
+@*/
+{
+	enum GatepaErr err;
+
+	err = autotrack_single(
+		tag, &op->arg.autotrack.key, op->arg.autotrack.pow10,
+		op->arg.autotrack.track_curr, op->arg.autotrack.track_total,
+		changed
+	);
+	op->arg.autotrack.track_curr += 1u;
+	return err;
+}
+
 /* ------------------------------------------------------------------------ */
 
 /* returns 0 on success */
 static enum GatepaErr
 autotrack_single(
-	struct Gatepa_Tag *const tag, const unsigned int pow10,
-	const unsigned int track_curr, const unsigned int track_total
+	struct Gatepa_Tag *const tag, const struct Gatepa_Key *const key,
+	const unsigned int pow10, const unsigned int track_curr,
+	const unsigned int track_total, /*@out@*/ bool *const changed
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
-		*tag
+		*tag,
+		*changed
 @*/
 {
-	const struct GString key = {
-		{ASCII_T_LO, ASCII_R_LO, ASCII_A_LO, ASCII_C_LO,
-		 ASCII_K_LO, 0,0,0 ,0,0,0,0
-		},
-		(uint32_t) 5u
-	};
-	const uint32_t item_idx = apetag_memtag_find_item(tag, &key);
+	const uint32_t item_idx = apetag_memtag_find_item(tag, key);
 	/* * */
 	struct Gatepa_Item item;
 	struct GString value;
@@ -131,6 +160,8 @@ autotrack_single(
 		enum GatepaErr	gat;
 	} err;
 
+	*changed = true;
+
 	/* create value */
 	num_printed = snprintf((char *) buf, sizeof buf, u8"%0*u/%0*u",
 		(int) pow10, track_curr, (int) pow10, track_total
@@ -149,7 +180,7 @@ autotrack_single(
 
 	if ( item_idx != UINT32_MAX ){
 		/* replace */
-		apetag_memitem_replace_value(
+		*changed = apetag_memitem_replace_value(
 			&tag->item[item_idx], &value, APEFLAG_ITEMTYPE_TEXT
 		);
 	}
@@ -159,7 +190,7 @@ autotrack_single(
 		if ( err.gat != 0 ){
 			return err.gat;
 		}
-		err.gat = apetag_memtag_add_item(tag, &key, &item);
+		err.gat = apetag_memtag_add_item(tag, key, &item);
 		if ( err.gat != 0 ){
 			return err.gat;
 		}
@@ -9,9 +9,9 @@
 //                                                                          //
 /////////////////////////////////////////////////////////////////////////// */
 
+#include <stdbool.h>
 #include <string.h>
 
-#include <libs/bitset.h>
 #include <libs/gbitset.h>
 
 #include "../apetag.h"
@@ -28,6 +28,17 @@
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+#undef tag
+#undef op
+#undef changed
+static enum GatepaErr clear_apply(
+	struct Gatepa_Tag *tag, struct ModeOp *op, /*@out@*/ bool *changed
+)
+/*@modifies	*tag,
+		*changed
+@*/
+;
+
 #undef tag
 static void clear_single(struct Gatepa_Tag *tag)
 /*@modifies	*tag@*/
@@ -35,42 +46,46 @@ static void clear_single(struct Gatepa_Tag *tag)
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+/* op->range is already init'd */
 /* returns 0 on success */
 GATEPA enum GatepaErr
-mode_clear(
-	const char *const arg_str, const char arg_sep,
-	const struct OpenFiles *const openfiles,
-	struct GBitset *const range_gbs
+mode_clear_compile(
+	/*@out@*/ struct ModeOp *const op, const char *const arg_str,
+	const char arg_sep, const struct OpenFiles *const openfiles
 )
-/*@modifies	openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 {
 	const size_t       arg_len   = strlen(arg_str);
-	const unsigned int num_files = openfiles->nmemb;
+	const unsigned int num_files = openfiles->nmemb_total;
 	/* * */
 	union {	int		i;
 		enum GatepaErr	gat;
 	} err;
-	size_t idx;
 
 	assert(num_files != 0);
 
 	MODE_SEP_COUNT(MODE_CLEAR_NFIELDS);
 
-	MODE_RANGE_GET(range_gbs, NULL);
+	MODE_RANGE_GET(&op->range, NULL);
 
-	/* clear each tag */
-	idx = 0;
-	goto loop_entr;
-	do {	clear_single(&openfiles->tag[idx]);
-		idx += 1u;
-loop_entr:
-		idx  = bitset_find_1(
-			GBITSET_PTR(range_gbs), range_gbs->bitlen, idx
-		);
-	} while ( idx != SIZE_MAX );
+	op->apply = clear_apply;
+	return 0;
+}
+
+/* returns 0 on success */
+static enum GatepaErr
+clear_apply(
+	struct Gatepa_Tag *const tag, /*@unused@*/ struct ModeOp *const op,
+	/*@out@*/ bool *const changed
+)
+/*@modifies	*tag,
+		*changed
+@*/
+{
+	(void) op;
 
+	*changed = (tag->nmemb != 0);
+	clear_single(tag);
 	return 0;
 }
 
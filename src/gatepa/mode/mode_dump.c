@@ -56,11 +56,12 @@ mode_dump(
 @*/
 {
 	const size_t       arg_len   = strlen(arg_str);
-	const unsigned int num_files = openfiles->nmemb;
+	const unsigned int num_files = openfiles->nmemb_total;
 	/* * */
 	union {	int		i;
 		enum GatepaErr	gat;
 	} err;
+	size_t nmemb_before, nmemb_total;
 	size_t idx;
 
 	assert(num_files != 0);
@@ -70,16 +71,16 @@ mode_dump(
 	MODE_RANGE_GET(range_gbs, NULL);
 
 	/* check that we are only extracting from one tag/file */
-	if ( bitset_popcount(GBITSET_PTR(range_gbs), range_gbs->bitlen)
-	   !=
-	    (size_t) 1u
-	){
+	MODE_RANGE_COUNT(range_gbs, &nmemb_before, &nmemb_total);
+	if ( nmemb_total != (size_t) 1u ){
 		return GATERR_SINGLE_TAG_ONLY;
 	}
 
 	/* dump the tag */
 	idx = bitset_find_1(GBITSET_PTR(range_gbs), range_gbs->bitlen, 0);
-	assert(idx != SIZE_MAX);
+	if ( idx == SIZE_MAX ){
+		return 0;	/* not in this window */
+	}
 	err.gat = dump_single(openfiles->fd[idx], &openfiles->info[idx]);
 
 	return err.gat;
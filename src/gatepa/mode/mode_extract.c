@@ -29,7 +29,23 @@
 
 /* //////////////////////////////////////////////////////////////////////// */
 
-static void extract_single(const struct Gatepa_Tag *, const struct GString *)
+#undef memkey
+#undef openfiles
+#undef range_gbs
+static enum GatepaErr extract_parse(
+	/*@out@*/ struct Gatepa_Key *memkey, const char *, char,
+	const struct OpenFiles *openfiles, struct GBitset *range_gbs
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*memkey,
+		*range_gbs
+@*/
+;
+
+static void extract_single(
+	const struct Gatepa_Tag *, const struct Gatepa_Key *
+)
 /*@globals	fileSystem@*/
 /*@modifies	fileSystem@*/
 ;
@@ -48,14 +64,69 @@ mode_extract(
 	const struct OpenFiles *const openfiles,
 	struct GBitset *const range_gbs
 )
-/*@globals	fileSystem@*/
+/*@globals	fileSystem,
+		internalState
+@*/
 /*@modifies	fileSystem,
+		internalState,
 		openfiles->tag[],
 		*range_gbs
 @*/
+{
+	struct Gatepa_Key memkey;
+	enum GatepaErr err;
+	size_t idx;
+
+	err = extract_parse(&memkey, arg_str, arg_sep, openfiles, range_gbs);
+	if ( err != 0 ){
+		return err;
+	}
+
+	/* extract the item */
+	idx = bitset_find_1(GBITSET_PTR(range_gbs), range_gbs->bitlen, 0);
+	if ( idx == SIZE_MAX ){
+		return 0;	/* not in this window */
+	}
+	extract_single(&openfiles->tag[idx], &memkey);
+
+	return 0;
+}
+
+/* returns 0 on success */
+GATEPA enum GatepaErr
+mode_extract_check(
+	const char *const arg_str, const char arg_sep,
+	const struct OpenFiles *const openfiles,
+	struct GBitset *const range_gbs
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*range_gbs
+@*/
+{
+	struct Gatepa_Key memkey;
+
+	return extract_parse(&memkey, arg_str, arg_sep, openfiles, range_gbs);
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* returns 0 on success */
+static enum GatepaErr
+extract_parse(
+	/*@out@*/ struct Gatepa_Key *const memkey,
+	const char *const arg_str, const char arg_sep,
+	const struct OpenFiles *const openfiles,
+	struct GBitset *const range_gbs
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*memkey,
+		*range_gbs
+@*/
 {
 	const size_t       arg_len   = strlen(arg_str);
-	const unsigned int num_files = openfiles->nmemb;
+	const unsigned int num_files = openfiles->nmemb_total;
 	/* * */
 	struct GString key;
 	/* * */
@@ -63,7 +134,7 @@ mode_extract(
 	union {	int		i;
 		enum GatepaErr	gat;
 	} err;
-	size_t idx;
+	size_t nmemb_before, nmemb_total;
 
 	assert(num_files != 0);
 
@@ -73,20 +144,16 @@ mode_extract(
 	arg_idx = size_read;
 
 	MODE_KEY_GET(&key);
+	apetag_memkey_make(memkey, &key);
 
 	/* check that we are only extracting from one tag/file */
-	if ( bitset_popcount(GBITSET_PTR(range_gbs), range_gbs->bitlen)
-	   !=
-	    (size_t) 1u
-	){
+	MODE_RANGE_COUNT(range_gbs, &nmemb_before, &nmemb_total);
+	if ( nmemb_total != (size_t) 1u ){
+		/*@-mustdefine@*/ /*@-mustmod@*/
 		return GATERR_SINGLE_TAG_ONLY;
+		/*@=mustdefine@*/ /*@=mustmod@*/
 	}
 
-	/* extract the item */
-	idx = bitset_find_1(GBITSET_PTR(range_gbs), range_gbs->bitlen, 0);
-	assert(idx != SIZE_MAX);
-	extract_single(&openfiles->tag[idx], &key);
-
 	return 0;
 }
 
@@ -94,7 +161,7 @@ mode_extract(
 
 static void
 extract_single(
-	const struct Gatepa_Tag *const tag, const struct GString *const key
+	const struct Gatepa_Tag *const tag, const struct Gatepa_Key *const key
 )
 /*@globals	fileSystem@*/
 /*@modifies	fileSystem@*/
@@ -100,7 +100,7 @@ print_body(
 @*/
 {
 	const size_t       arg_len   = strlen(arg_str);
-	const unsigned int num_files = openfiles->nmemb;
+	const unsigned int num_files = openfiles->nmemb_total;
 	/* * */
 	union {	int		i;
 		enum GatepaErr	gat;
@@ -123,7 +123,13 @@ loop_entr:
 			GBITSET_PTR(range_gbs), range_gbs->bitlen, idx
 		);
 	} while ( idx != SIZE_MAX );
-	(void) fputc('\n', stdout);
+
+	/* the blank line after the last tag is only printed once (by the last
+	     window), so that --window doesn't add one per window
+	*/
+	if ( openfiles->idx_base + openfiles->nmemb == num_files ){
+		(void) fputc('\n', stdout);
+	}
 
 	return 0;
 }
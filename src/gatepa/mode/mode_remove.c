@@ -9,9 +9,9 @@
 //                                                                          //
 /////////////////////////////////////////////////////////////////////////// */
 
+#include <stdbool.h>
 #include <string.h>
 
-#include <libs/bitset.h>
 #include <libs/gbitset.h>
 #include <libs/gstring.h>
 
@@ -30,28 +30,41 @@
 /* //////////////////////////////////////////////////////////////////////// */
 
 #undef tag
+#undef op
+#undef changed
+static enum GatepaErr remove_apply(
+	struct Gatepa_Tag *tag, struct ModeOp *op, /*@out@*/ bool *changed
+)
+/*@modifies	*tag,
+		*changed
+@*/
+;
+
+#undef tag
+#undef changed
 static enum GatepaErr remove_single(
-	struct Gatepa_Tag *tag, const struct GString *
+	struct Gatepa_Tag *tag, const struct Gatepa_Key *,
+	/*@out@*/ bool *changed
 )
-/*@modifies	*tag@*/
+/*@modifies	*tag,
+		*changed
+@*/
 ;
 
 /* //////////////////////////////////////////////////////////////////////// */
 
 /* remove an item from tag(s) */
+/* op->range is already init'd */
 /* returns 0 on success */
 GATEPA enum GatepaErr
-mode_remove(
-	const char *const arg_str, const char arg_sep,
-	const struct OpenFiles *const openfiles,
-	struct GBitset *const range_gbs
+mode_remove_compile(
+	/*@out@*/ struct ModeOp *const op, const char *const arg_str,
+	const char arg_sep, const struct OpenFiles *const openfiles
 )
-/*@modifies	openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 {
 	const size_t       arg_len   = strlen(arg_str);
-	const unsigned int num_files = openfiles->nmemb;
+	const unsigned int num_files = openfiles->nmemb_total;
 	/* * */
 	struct GString key;
 	/* * */
@@ -59,42 +72,48 @@ mode_remove(
 	union {	int		i;
 		enum GatepaErr	gat;
 	} err;
-	size_t idx;
 
 	MODE_SEP_COUNT(MODE_REMOVE_NFIELDS);
 
-	MODE_RANGE_GET(range_gbs, &size_read);
+	MODE_RANGE_GET(&op->range, &size_read);
 	arg_idx = size_read;
 
 	MODE_KEY_GET_NOVERIFY(&key);
+	apetag_memkey_make(&op->arg.remove, &key);
 
-	/* remove the item in each tag */
-	idx = 0;
-	goto loop_entr;
-	do {	err.gat = remove_single(&openfiles->tag[idx], &key);
-		if ( err.gat != 0 ){
-			return err.gat;
-		}
-		idx += 1u;
-loop_entr:
-		idx  = bitset_find_1(
-			GBITSET_PTR(range_gbs), range_gbs->bitlen, idx
-		);
-	} while ( idx != SIZE_MAX );
-
+	op->apply = remove_apply;
 	return 0;
 }
 
+/* returns 0 on success */
+static enum GatepaErr
+remove_apply(
+	struct Gatepa_Tag *const tag, struct ModeOp *const op,
+	/*@out@*/ bool *const changed
+)
+/*@modifies	*tag,
+		*changed
+@*/
+{
+	return remove_single(tag, &op->arg.remove, changed);
+}
+
 /* ------------------------------------------------------------------------ */
 
 /* returns 0 on success */
 static enum GatepaErr
-remove_single(struct Gatepa_Tag *const tag, const struct GString *const key)
-/*@modifies	*tag@*/
+remove_single(
+	struct Gatepa_Tag *const tag, const struct Gatepa_Key *const key,
+	/*@out@*/ bool *const changed
+)
+/*@modifies	*tag,
+		*changed
+@*/
 {
 	const uint32_t item_idx = apetag_memtag_find_item(tag, key);
 	enum GatepaErr err;
 
+	*changed = (item_idx != UINT32_MAX);
 	if ( item_idx != UINT32_MAX ){
 		err = apetag_memtag_remove_item(tag, item_idx);
 		if ( err != 0 ){
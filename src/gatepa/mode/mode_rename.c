@@ -9,10 +9,10 @@
 //                                                                          //
 /////////////////////////////////////////////////////////////////////////// */
 
+#include <stdbool.h>
 #include <stdint.h>
 #include <string.h>
 
-#include <libs/bitset.h>
 #include <libs/gbitset.h>
 #include <libs/gstring.h>
 
@@ -31,28 +31,41 @@
 /* //////////////////////////////////////////////////////////////////////// */
 
 #undef tag
+#undef op
+#undef changed
+static enum GatepaErr rename_apply(
+	struct Gatepa_Tag *tag, struct ModeOp *op, /*@out@*/ bool *changed
+)
+/*@modifies	*tag,
+		*changed
+@*/
+;
+
+#undef tag
+#undef changed
 static enum GatepaErr rename_single(
-	struct Gatepa_Tag *tag, const struct GString *, const struct GString *
+	struct Gatepa_Tag *tag, const struct Gatepa_Key *,
+	const struct Gatepa_Key *, /*@out@*/ bool *changed
 )
-/*@modifies	*tag@*/
+/*@modifies	*tag,
+		*changed
+@*/
 ;
 
 /* //////////////////////////////////////////////////////////////////////// */
 
 /* rename an item key */
+/* op->range is already init'd */
 /* returns 0 on success */
 GATEPA enum GatepaErr
-mode_rename(
-	const char *const arg_str, const char arg_sep,
-	const struct OpenFiles *const openfiles,
-	struct GBitset *const range_gbs
+mode_rename_compile(
+	/*@out@*/ struct ModeOp *const op, const char *const arg_str,
+	const char arg_sep, const struct OpenFiles *const openfiles
 )
-/*@modifies	openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 {
 	const size_t       arg_len   = strlen(arg_str);
-	const unsigned int num_files = openfiles->nmemb;
+	const unsigned int num_files = openfiles->nmemb_total;
 	/* * */
 	struct GString old_key, new_key;
 	/* * */
@@ -60,11 +73,10 @@ mode_rename(
 	union {	int		i;
 		enum GatepaErr	gat;
 	} err;
-	size_t idx;
 
 	MODE_SEP_COUNT(MODE_RENAME_NFIELDS);
 
-	MODE_RANGE_GET(range_gbs, &size_read);
+	MODE_RANGE_GET(&op->range, &size_read);
 	arg_idx  = size_read;
 
 	MODE_KEY_GET_NOVERIFY(&old_key);
@@ -72,39 +84,55 @@ mode_rename(
 
 	MODE_KEY_GET(&new_key);
 
-	/* rename the item key in each tag */
-	idx = 0;
-	goto loop_entr;
-	do {	err.gat = rename_single(
-			&openfiles->tag[idx], &old_key, &new_key
-		);
-		if ( err.gat != 0 ){
-			return err.gat;
-		}
-		idx += 1u;
-loop_entr:
-		idx  = bitset_find_1(
-			GBITSET_PTR(range_gbs), range_gbs->bitlen, idx
-		);
-	} while ( idx != SIZE_MAX );
+	apetag_memkey_make(&op->arg.rename.old_key, &old_key);
+	apetag_memkey_make(&op->arg.rename.new_key, &new_key);
 
+	op->apply = rename_apply;
 	return 0;
 }
 
+/* returns 0 on success */
+static enum GatepaErr
+rename_apply(
+	struct Gatepa_Tag *const tag, struct ModeOp *const op,
+	/*@out@*/ bool *const changed
+)
+/*@modifies	*tag,
+		*changed
+@*/
+{
+	return rename_single(
+		tag, &op->arg.rename.old_key, &op->arg.rename.new_key, changed
+	);
+}
+
 /* ------------------------------------------------------------------------ */
 
 /* returns 0 on success */
 static enum GatepaErr
 rename_single(
 	struct Gatepa_Tag *const tag,
-	const struct GString *const old_key,
-	const struct GString *const new_key
+	const struct Gatepa_Key *const old_key,
+	const struct Gatepa_Key *const new_key, /*@out@*/ bool *const changed
 )
-/*@modifies	*tag@*/
+/*@modifies	*tag,
+		*changed
+@*/
 {
 	const uint32_t item_idx = apetag_memtag_find_item(tag, old_key);
+	const struct GString *key;
 
+	*changed = false;
 	if ( item_idx != UINT32_MAX ){
+		/* a rename to the very same key is a no-op */
+		key      = &tag->key[item_idx];
+		*changed = (key->len != new_key->str.len);
+		if ( !*changed ){
+			*changed = (memcmp(
+				GSTRING_PTR(key), GSTRING_PTR(&new_key->str),
+				(size_t) key->len
+			) != 0);
+		}
 		apetag_memtag_rename_item(tag, item_idx, new_key);
 	}
 	/*@-mustmod@*/
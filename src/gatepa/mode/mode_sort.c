@@ -9,9 +9,9 @@
 //                                                                          //
 /////////////////////////////////////////////////////////////////////////// */
 
+#include <stdbool.h>
 #include <string.h>
 
-#include <libs/bitset.h>
 #include <libs/gbitset.h>
 #include <libs/gstring.h>
 
@@ -31,25 +31,37 @@
 
 /* //////////////////////////////////////////////////////////////////////// */
 
-#undef openfiles
-#undef range_gbs
+#undef op
 NOINLINE
-static enum GatepaErr sort_body(
-	const char *, char, const struct OpenFiles *openfiles,
-	struct GBitset *range_gbs, enum Sort_TagCompar
+static enum GatepaErr sort_compile(
+	/*@out@*/ struct ModeOp *op, const char *, char,
+	const struct OpenFiles *, enum Sort_TagCompar
+)
+/*@modifies	*op@*/
+;
+
+#undef tag
+#undef op
+#undef changed
+static enum GatepaErr sort_apply(
+	struct Gatepa_Tag *tag, struct ModeOp *op, /*@out@*/ bool *changed
 )
 /*@globals	internalState@*/
 /*@modifies	internalState,
-		openfiles->tag[],
-		*range_gbs
+		*tag,
+		*changed
 @*/
 ;
 
 #undef tag
-static enum GatepaErr sort_single(struct Gatepa_Tag *tag, enum Sort_TagCompar)
+#undef changed
+static enum GatepaErr sort_single(
+	struct Gatepa_Tag *tag, enum Sort_TagCompar, /*@out@*/ bool *changed
+)
 /*@globals	internalState@*/
 /*@modifies	internalState,
-		*tag
+		*tag,
+		*changed
 @*/
 ;
 
@@ -80,104 +92,95 @@ static void psort_item(
 
 /* returns 0 on success */
 GATEPA enum GatepaErr
-mode_sort_audio(
-	const char *const arg_str, const char arg_sep,
-	const struct OpenFiles *const openfiles,
-	struct GBitset *const range_gbs
+mode_sort_audio_compile(
+	/*@out@*/ struct ModeOp *const op, const char *const arg_str,
+	const char arg_sep, const struct OpenFiles *const openfiles
 )
-/*@globals	internalState@*/
-/*@modifies	internalState,
-		openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 {
-	return sort_body(
-		arg_str, arg_sep, openfiles, range_gbs, TAGCOMPAR_AUDIO
-	);
+	return sort_compile(op, arg_str, arg_sep, openfiles, TAGCOMPAR_AUDIO);
 }
 
 /* returns 0 on success */
 GATEPA enum GatepaErr
-mode_sort_alpha(
-	const char *const arg_str, const char arg_sep,
-	const struct OpenFiles *const openfiles,
-	struct GBitset *const range_gbs
+mode_sort_alpha_compile(
+	/*@out@*/ struct ModeOp *const op, const char *const arg_str,
+	const char arg_sep, const struct OpenFiles *const openfiles
 )
-/*@globals	internalState@*/
-/*@modifies	internalState,
-		openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 {
-	return sort_body(
-		arg_str, arg_sep, openfiles, range_gbs, TAGCOMPAR_ALPHA
-	);
+	return sort_compile(op, arg_str, arg_sep, openfiles, TAGCOMPAR_ALPHA);
 }
 
+/* op->range is already init'd */
 /* returns 0 on success */
 NOINLINE
 static enum GatepaErr
-sort_body(
-	const char *const arg_str, const char arg_sep,
-	const struct OpenFiles *const openfiles,
-	struct GBitset *const range_gbs, const enum Sort_TagCompar sorttype
+sort_compile(
+	/*@out@*/ struct ModeOp *const op, const char *const arg_str,
+	const char arg_sep, const struct OpenFiles *const openfiles,
+	const enum Sort_TagCompar sorttype
 )
-/*@globals	internalState@*/
-/*@modifies	internalState,
-		openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 {
 	const size_t       arg_len   = strlen(arg_str);
-	const unsigned int num_files = openfiles->nmemb;
+	const unsigned int num_files = openfiles->nmemb_total;
 	/* * */
 	union {	int		i;
 		enum GatepaErr	gat;
 	} err;
-	size_t idx;
 
 	assert(num_files != 0);
 
 	MODE_SEP_COUNT(MODE_SORT_NFIELDS);
 
-	MODE_RANGE_GET(range_gbs, NULL);
-
-	/* sort each tag */
-	idx = 0;
-	goto loop_entr;
-	do {	err.gat = sort_single(&openfiles->tag[idx], sorttype);
-		if ( err.gat != 0 ){
-			return err.gat;
-		}
-		idx += 1u;
-loop_entr:
-		idx  = bitset_find_1(
-			GBITSET_PTR(range_gbs), range_gbs->bitlen, idx
-		);
-	} while ( idx != SIZE_MAX );
+	MODE_RANGE_GET(&op->range, NULL);
 
+	op->arg.sort = sorttype;
+	op->apply    = sort_apply;
 	return 0;
 }
 
+/* returns 0 on success */
+static enum GatepaErr
+sort_apply(
+	struct Gatepa_Tag *const tag, struct ModeOp *const op,
+	/*@out@*/ bool *const changed
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*tag,
+		*changed
+@*/
+{
+	return sort_single(tag, op->arg.sort, changed);
+}
+
 /* ------------------------------------------------------------------------ */
 
 /* returns 0 on success */
 static enum GatepaErr
-sort_single(struct Gatepa_Tag *const tag, const enum Sort_TagCompar sorttype)
+sort_single(
+	struct Gatepa_Tag *const tag, const enum Sort_TagCompar sorttype,
+	/*@out@*/ bool *const changed
+)
 /*@globals	internalState@*/
 /*@modifies	internalState,
-		*tag
+		*tag,
+		*changed
 @*/
 {
+	struct Sort_Columns columns;
 	void *temp_sorted;
 	uint32_t *idx_array;
-	int (*compar_fn)(const void *, const void *, void *);
 	union {	int		i;
 		enum GatepaErr	gat;
 	} err;
 	size_t temp_size;
 	uint32_t i;
 
+	*changed = false;
+
 	/* create an index array */
 	err.i = gatepa_alloc_scratch_reset();
 	if ( err.i != 0 ){
@@ -197,20 +200,38 @@ sort_single(struct Gatepa_Tag *const tag, const enum Sort_TagCompar sorttype)
 		idx_array[i] = i;
 	}
 
-	/* sort the index array */
-	switch ( sorttype ){
-	case TAGCOMPAR_AUDIO:
-		compar_fn = apetag_compar_audio;
-		break;
-	case TAGCOMPAR_ALPHA:
-		compar_fn = apetag_compar_alpha;
-		break;
+	/* gather what the items are compared by */
+	columns.tag   = tag;
+	columns.score = gatepa_alloc_scratch(
+		sizeof *columns.score, (size_t) tag->nmemb
+	);
+	columns.size  = gatepa_alloc_scratch(
+		sizeof *columns.size, (size_t) tag->nmemb
+	);
+	if ( (columns.score == NULL) || (columns.size == NULL) ){
+		/*@-mustmod@*/
+		return GATERR_ALLOCATOR;
+		/*@=mustmod@*/
 	}
+	apetag_sort_columns(&columns, sorttype);
+
+	/* sort the index array */
 	qsort_r(
 		idx_array, (size_t) tag->nmemb, sizeof idx_array[0],
-		compar_fn, tag
+		apetag_compar_columns, &columns
 	);
 
+	/* a tag that is already in order is left as is */
+	for ( i = 0; i < tag->nmemb; ++i ){
+		if ( idx_array[i] != i ){
+			break;
+		}
+	}
+	if ( i == tag->nmemb ){
+		return 0;
+	}
+	*changed = true;
+
 	/* sort the parallel arrays by the index array using a temp array */
 	temp_size   = (sizeof tag->item[0] > sizeof tag->key[0]
 		? sizeof tag->item[0] : sizeof tag->key[0]
@@ -223,6 +244,7 @@ sort_single(struct Gatepa_Tag *const tag, const enum Sort_TagCompar sorttype)
 	}
 	psort_key(tag->key, temp_sorted, idx_array, tag->nmemb);
 	psort_item(tag->item, temp_sorted, idx_array, tag->nmemb);
+	apetag_memtag_reindex(tag);
 
 	return 0;
 }
@@ -9,10 +9,10 @@
 //                                                                          //
 /////////////////////////////////////////////////////////////////////////// */
 
+#include <stdbool.h>
 #include <string.h>
 
 #include <libs/ascii-literals.h>
-#include <libs/bitset.h>
 #include <libs/gbitset.h>
 #include <libs/gstring.h>
 
@@ -32,40 +32,48 @@
 
 /* //////////////////////////////////////////////////////////////////////// */
 
-typedef void (*tidykeys_fnptr)(struct GString *);
+/* returns whether the key changed */
+typedef bool (*tidykeys_fnptr)(struct GString *);
 
 /* //////////////////////////////////////////////////////////////////////// */
 
-#undef openfiles
-#undef range_gbs
+#undef op
 NOINLINE
-static enum GatepaErr
-tidykeys_body(
-	const char *, char, const struct OpenFiles *openfiles,
-	struct GBitset *range_gbs, tidykeys_fnptr
+static enum GatepaErr tidykeys_compile(
+	/*@out@*/ struct ModeOp *op, const char *, char,
+	const struct OpenFiles *, tidykeys_fnptr
+)
+/*@modifies	*op@*/
+;
+
+#undef tag
+#undef op
+#undef changed
+static enum GatepaErr tidykeys_apply(
+	struct Gatepa_Tag *tag, struct ModeOp *op, /*@out@*/ bool *changed
 )
-/*@modifies	openfiles->tag[],
-		*range_gbs
+/*@modifies	tag->key[],
+		*changed
 @*/
 ;
 
 #undef tag
-static void tidykeys_single(struct Gatepa_Tag *tag, tidykeys_fnptr)
+static bool tidykeys_single(struct Gatepa_Tag *tag, tidykeys_fnptr)
 /*@modifies	tag->key[]@*/
 ;
 
 #undef key
-static void tidykeys_single_lo(struct GString *key)
+static bool tidykeys_single_lo(struct GString *key)
 /*@modifies	*key@*/
 ;
 
 #undef key
-static void tidykeys_single_up(struct GString *key)
+static bool tidykeys_single_up(struct GString *key)
 /*@modifies	*key@*/
 ;
 
 #undef key
-static void tidykeys_single_1up(struct GString *key)
+static bool tidykeys_single_1up(struct GString *key)
 /*@modifies	*key@*/
 ;
 
@@ -73,151 +81,166 @@ static void tidykeys_single_1up(struct GString *key)
 
 /* returns 0 on success */
 GATEPA enum GatepaErr
-mode_tidykeys_lo(
-	const char *const arg_str, const char arg_sep,
-	const struct OpenFiles *const openfiles,
-	struct GBitset *const range_gbs
+mode_tidykeys_lo_compile(
+	/*@out@*/ struct ModeOp *const op, const char *const arg_str,
+	const char arg_sep, const struct OpenFiles *const openfiles
 )
-/*@modifies	openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 {
-	return tidykeys_body(
-		arg_str, arg_sep, openfiles, range_gbs, tidykeys_single_lo
+	return tidykeys_compile(
+		op, arg_str, arg_sep, openfiles, tidykeys_single_lo
 	);
 }
 
 /* returns 0 on success */
 GATEPA enum GatepaErr
-mode_tidykeys_up(
-	const char *const arg_str, const char arg_sep,
-	const struct OpenFiles *const openfiles,
-	struct GBitset *const range_gbs
+mode_tidykeys_up_compile(
+	/*@out@*/ struct ModeOp *const op, const char *const arg_str,
+	const char arg_sep, const struct OpenFiles *const openfiles
 )
-/*@modifies	openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 {
-	return tidykeys_body(
-		arg_str, arg_sep, openfiles, range_gbs, tidykeys_single_up
+	return tidykeys_compile(
+		op, arg_str, arg_sep, openfiles, tidykeys_single_up
 	);
 }
 
 /* returns 0 on success */
 GATEPA enum GatepaErr
-mode_tidykeys_1up(
-	const char *const arg_str, const char arg_sep,
-	const struct OpenFiles *const openfiles,
-	struct GBitset *const range_gbs
+mode_tidykeys_1up_compile(
+	/*@out@*/ struct ModeOp *const op, const char *const arg_str,
+	const char arg_sep, const struct OpenFiles *const openfiles
 )
-/*@modifies	openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 {
-	return tidykeys_body(
-		arg_str, arg_sep, openfiles, range_gbs, tidykeys_single_1up
+	return tidykeys_compile(
+		op, arg_str, arg_sep, openfiles, tidykeys_single_1up
 	);
 }
 
+/* op->range is already init'd */
 /* returns 0 on success */
 NOINLINE
 static enum GatepaErr
-tidykeys_body(
-	const char *const arg_str, const char arg_sep,
-	const struct OpenFiles *const openfiles,
-	struct GBitset *const range_gbs, const tidykeys_fnptr fn
+tidykeys_compile(
+	/*@out@*/ struct ModeOp *const op, const char *const arg_str,
+	const char arg_sep, const struct OpenFiles *const openfiles,
+	const tidykeys_fnptr fn
 )
-/*@modifies	openfiles->tag[],
-		*range_gbs
-@*/
+/*@modifies	*op@*/
 {
 	const size_t       arg_len   = strlen(arg_str);
-	const unsigned int num_files = openfiles->nmemb;
+	const unsigned int num_files = openfiles->nmemb_total;
 	/* * */
 	union {	int		i;
 		enum GatepaErr	gat;
 	} err;
-	size_t idx;
 
 	assert(num_files != 0);
 
 	MODE_SEP_COUNT(MODE_TIDYKEYS_NFIELDS);
 
-	MODE_RANGE_GET(range_gbs, NULL);
+	MODE_RANGE_GET(&op->range, NULL);
 
-	/* tidy each key */
-	idx = 0;
-	goto loop_entr;
-	do {	tidykeys_single(&openfiles->tag[idx], fn);
-		idx += 1u;
-loop_entr:
-		idx  = bitset_find_1(
-			GBITSET_PTR(range_gbs), range_gbs->bitlen, idx
-		);
-	} while ( idx != SIZE_MAX );
+	op->arg.tidykeys = fn;
+	op->apply        = tidykeys_apply;
+	return 0;
+}
 
+/* returns 0 on success */
+static enum GatepaErr
+tidykeys_apply(
+	struct Gatepa_Tag *const tag, struct ModeOp *const op,
+	/*@out@*/ bool *const changed
+)
+/*@modifies	tag->key[],
+		*changed
+@*/
+{
+	*changed = tidykeys_single(tag, op->arg.tidykeys);
 	return 0;
 }
 
 /* ------------------------------------------------------------------------ */
 
-static void
+/* returns whether any key changed */
+static bool
 tidykeys_single(struct Gatepa_Tag *const tag, const tidykeys_fnptr fn)
 /*@modifies	tag->key[]@*/
 {
+	bool changed = false;
 	uint32_t i;
 
 	for ( i = 0; i < tag->nmemb; ++i ){
-		/*@-noeffectuncon@*/
-		fn(&tag->key[i]);
-		/*@=noeffectuncon@*/
+		if ( fn(&tag->key[i]) ){
+			changed = true;
+		}
 		gstring_mod_fini(&tag->key[i]);
 	}
-	return;
+	return changed;
 }
 
-static void
+/* returns whether the key changed */
+static bool
 tidykeys_single_lo(struct GString *const key)
 /*@modifies	*key@*/
 {
 	uint8_t *const ptr = GSTRING_PTR(key);
+	bool changed = false;
+	uint8_t c;
 	uint32_t i;
 
 	for ( i = 0; i < key->len; ++i ){
-		ptr[i] = ascii_tolower(ptr[i]);
+		c = ascii_tolower(ptr[i]);
+		if ( c != ptr[i] ){
+			ptr[i]  = c;
+			changed = true;
+		}
 	}
-	return;
+	return changed;
 }
 
-static void
+/* returns whether the key changed */
+static bool
 tidykeys_single_up(struct GString *const key)
 /*@modifies	*key@*/
 {
 	uint8_t *const ptr = GSTRING_PTR(key);
+	bool changed = false;
+	uint8_t c;
 	uint32_t i;
 
 	for ( i = 0; i < key->len; ++i ){
-		ptr[i] = ascii_toupper(ptr[i]);
+		c = ascii_toupper(ptr[i]);
+		if ( c != ptr[i] ){
+			ptr[i]  = c;
+			changed = true;
+		}
 	}
-	return;
+	return changed;
 }
 
-static void
+/* returns whether the key changed */
+static bool
 tidykeys_single_1up(struct GString *const key)
 /*@modifies	*key@*/
 {
 	uint8_t *const ptr = GSTRING_PTR(key);
+	bool changed = false;
 	uint8_t c = ASCII_SP;
 	uint32_t i;
 
 	for ( i = 0; i < key->len; ++i ){
 		if ( (c == ASCII_SP) || (c == ASCII_USCORE) ){
-			ptr[i] = ascii_toupper(ptr[i]);
+			c = ascii_toupper(ptr[i]);
+		}
+		else {	c = ascii_tolower(ptr[i]); }
+		if ( c != ptr[i] ){
+			ptr[i]  = c;
+			changed = true;
 		}
-		else {	ptr[i] = ascii_tolower(ptr[i]); }
-		c = ptr[i];
 	}
-	return;
+	return changed;
 }
 
 /* EOF //////////////////////////////////////////////////////////////////// */
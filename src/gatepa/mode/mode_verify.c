@@ -63,7 +63,7 @@ static uint32_t verify_tag_keys_size(
 /*@*/
 ;
 
-static enum GatepaErr verify_tag_keys_repeat(const struct GString *, uint32_t)
+static enum GatepaErr verify_tag_keys_repeat(const struct Gatepa_Tag *)
 /*@globals	internalState*/
 /*@modifies	internalState*/
 ;
@@ -105,7 +105,7 @@ mode_verify(
 @*/
 {
 	const size_t       arg_len   = strlen(arg_str);
-	const unsigned int num_files = openfiles->nmemb;
+	const unsigned int num_files = openfiles->nmemb_total;
 	/* * */
 	enum GatepaErr retval = 0;
 	union {	int		i;
@@ -223,7 +223,7 @@ verify_single(
 		err_count += 1u;
 	}
 	/* * */
-	err.gat = verify_tag_keys_repeat(tag->key, tag->nmemb);
+	err.gat = verify_tag_keys_repeat(tag);
 	if UNLIKELY ( err.gat == GATERR_FAIL ){
 		if ( err_count == 0 ){
 			gatepa_warning_header(openfiles, file_idx);
@@ -326,10 +326,12 @@ verify_tag_keys_size(
 	or some other error
 */
 static enum GatepaErr
-verify_tag_keys_repeat(const struct GString *const keys, const uint32_t nmemb)
+verify_tag_keys_repeat(const struct Gatepa_Tag *const tag)
 /*@globals	internalState*/
 /*@modifies	internalState*/
 {
+	const uint32_t nmemb = tag->nmemb;
+	/* * */
 	uint32_t *idx_array;
 	int cmp;
 	uint32_t i;
@@ -348,13 +350,13 @@ verify_tag_keys_repeat(const struct GString *const keys, const uint32_t nmemb)
 	/* sort the index array by the real array */
 	qsort_r(
 		idx_array, (size_t) nmemb, sizeof idx_array[0],
-		verify_tag_key_repeat_compar, (void *) keys
+		verify_tag_key_repeat_compar, (void *) tag
 	);
 
 	/* check for repeats */
 	for ( i = (uint32_t) 1u; i < nmemb; ++i ){
-		cmp = gstring_cmp_gstring(
-			&keys[i - 1u], &keys[i], ascii_casecmp
+		cmp = apetag_memtag_cmp_key(
+			tag, idx_array[i - 1u], idx_array[i]
 		);
 		if ( cmp == 0 ){
 			return GATERR_FAIL;
@@ -373,9 +375,9 @@ verify_tag_key_repeat_compar(
 {
 	const uint32_t a_idx = *((uint32_t *) a);
 	const uint32_t b_idx = *((uint32_t *) b);
-	const struct GString *const keys = arg;
+	const struct Gatepa_Tag *const tag = arg;
 
-	return gstring_cmp_gstring(&keys[a_idx], &keys[b_idx], ascii_casecmp);
+	return apetag_memtag_cmp_key(tag, a_idx, b_idx);
 }
 
 /* returns the number of bad items */
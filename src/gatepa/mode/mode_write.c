@@ -9,6 +9,7 @@
 //                                                                          //
 /////////////////////////////////////////////////////////////////////////// */
 
+#include <stdbool.h>
 #include <string.h>
 
 #include <libs/bitset.h>
@@ -18,6 +19,7 @@
 #include "../alloc.h"
 #include "../apetag.h"
 #include "../attributes.h"
+#include "../journal.h"
 #include "../mode.h"
 #include "../open.h"
 
@@ -43,24 +45,96 @@ static enum GatepaErr write_body(
 /*@modifies	fileSystem,
 		internalState,
 		openfiles->tag[],
+		openfiles->dirty[],
+		openfiles->disk[],
 		*range_gbs
 @*/
 ;
 
+static enum GatepaErr write_journal(
+	const struct OpenFiles *, const uint8_t *, size_t
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+;
+
+static enum GatepaErr write_sync_file(nbufio_fd, off_t)
+/*@globals	fileSystem,
+		g_apetag
+@*/
+/*@modifies	fileSystem@*/
+;
+
+PURE
+static bool write_is_unchanged(
+	const struct OpenFiles *, size_t, enum Write_TagType
+)
+/*@globals	g_apetag@*/
+;
+
+#undef differs
+static enum GatepaErr write_differs(
+	/*@out@*/ bool *differs, const struct OpenFiles *, size_t,
+	enum Write_TagType
+)
+/*@globals	internalState,
+		g_apetag
+@*/
+/*@modifies	internalState,
+		*differs
+@*/
+;
+
+#undef buf_out
+#undef size_out
+#undef pad_size_out
+static enum GatepaErr write_build(
+	/*@out@*/ uint8_t **buf_out, /*@out@*/ size_t *size_out,
+	/*@out@*/ size_t *pad_size_out, const struct Gatepa_FileInfo *,
+	const struct Gatepa_Tag *, enum Write_TagType
+)
+/*@globals	internalState,
+		g_apetag
+@*/
+/*@modifies	internalState,
+		*buf_out,
+		*size_out,
+		*pad_size_out
+@*/
+;
+
 #undef info
+#undef disk
 static enum GatepaErr write_single(
-	nbufio_fd, struct Gatepa_FileInfo *info, const struct Gatepa_Tag *,
+	nbufio_fd, struct Gatepa_FileInfo *info,
+	const uint8_t **disk, const struct Gatepa_Tag *,
 	enum Write_TagType
 )
 /*@globals	fileSystem,
-		internalState
+		internalState,
+		g_apetag
 @*/
 /*@modifies	fileSystem,
 		internalState,
-		*info
+		*info,
+		*disk
 @*/
 ;
 
+PURE
+static size_t write_diff_prefix(const uint8_t *, const uint8_t *, size_t)
+/*@*/
+;
+
+PURE
+static size_t write_pad_size(const struct Gatepa_FileInfo *, size_t)
+/*@globals	g_apetag@*/
+;
+
 /* //////////////////////////////////////////////////////////////////////// */
 
 /* returns 0 on success */
@@ -118,16 +192,23 @@ write_body(
 /*@modifies	fileSystem,
 		internalState,
 		openfiles->tag[],
+		openfiles->dirty[],
+		openfiles->disk[],
 		*range_gbs
 @*/
 {
 	const size_t       arg_len   = strlen(arg_str);
-	const unsigned int num_files = openfiles->nmemb;
+	const unsigned int num_files = openfiles->nmemb_total;
 	/* * */
+	nbufio_fd *written = NULL;
+	uint8_t *towrite;
+	unsigned int num_towrite = 0, num_written = 0;
+	bool differs;
 	union {	int		i;
 		enum GatepaErr	gat;
 	} err;
 	size_t idx;
+	unsigned int i;
 
 	assert(num_files != 0);
 
@@ -135,64 +216,363 @@ write_body(
 
 	MODE_RANGE_GET(range_gbs, NULL);
 
-	/* write each tag */
+	/* find the tags that would change on disk, before any file is locked,
+	     journaled, or synced
+	*/
+	towrite = gatepa_alloc_a16(
+		sizeof *towrite, (size_t) BITSET_BYTELEN(range_gbs->bitlen)
+	);
+	if ( towrite == NULL ){
+		return GATERR_ALLOCATOR;
+	}
+	(void) memset(
+		towrite, 0x00, (size_t) BITSET_BYTELEN(range_gbs->bitlen)
+	);
+	idx = 0;
+	goto diff_entr;
+	do {	err.gat = write_differs(&differs, openfiles, idx, type);
+		if ( err.gat != 0 ){
+			return err.gat;
+		}
+		if ( differs ){
+			(void) bitset_set_1(towrite, idx);
+			num_towrite += 1u;
+		}
+		else {	(void) bitset_set_0(openfiles->dirty, idx); }
+		idx += 1u;
+diff_entr:
+		idx  = bitset_find_1(
+			GBITSET_PTR(range_gbs), range_gbs->bitlen, idx
+		);
+	} while ( idx != SIZE_MAX );
+	if ( num_towrite == 0 ){
+		return 0;
+	}
+
+	/* the files to flush at the end of the batch */
+	if ( g_apetag.sync == WRITESYNC_BATCH ){
+		written = gatepa_alloc_a16(
+			sizeof *written, (size_t) num_towrite
+		);
+		if ( written == NULL ){
+			return GATERR_ALLOCATOR;
+		}
+	}
+
+	/* record the old tags before any of them are overwritten */
+	if ( g_journal.path != NULL ){
+		err.gat = write_journal(openfiles, towrite, range_gbs->bitlen);
+		if ( err.gat != 0 ){
+			return err.gat;
+		}
+	}
+
+	/* write each tag that differs */
 	idx = 0;
 	goto loop_entr;
 	do {	err.gat = write_single(
 			openfiles->fd[idx], &openfiles->info[idx],
-			&openfiles->tag[idx], type
+			&openfiles->disk[idx], &openfiles->tag[idx], type
 		);
 		if ( err.gat != 0 ){
 			return err.gat;
 		}
+		(void) bitset_set_0(openfiles->dirty, idx);
+
+		err.gat = write_sync_file(
+			openfiles->fd[idx], openfiles->info[idx].off_begin
+		);
+		if ( err.gat != 0 ){
+			return err.gat;
+		}
+		if ( written != NULL ){
+			written[num_written++] = openfiles->fd[idx];
+		}
 		idx += 1u;
 loop_entr:
-		idx  = bitset_find_1(
-			GBITSET_PTR(range_gbs), range_gbs->bitlen, idx
-		);
+		idx  = bitset_find_1(towrite, range_gbs->bitlen, idx);
 	} while ( idx != SIZE_MAX );
 
+	/* wait on the writeback started for each file (the journal can only
+	     be emptied once the batch is on disk)
+	*/
+	for ( i = 0; i < num_written; ++i ){
+		err.i = nbufio_datasync(written[i]);
+		if ( err.i != 0 ){
+			return GATERR_IO_SYNC;
+		}
+	}
+
+	if ( g_journal.path != NULL ){
+		return journal_batch_done();
+	}
 	return 0;
 }
 
+/* journals each tag that write_body() will overwrite, then syncs the
+     journal once for the whole batch
+*/
+/* returns 0 on success */
 static enum GatepaErr
-write_single(
-	const nbufio_fd fd, struct Gatepa_FileInfo *const info,
-	const struct Gatepa_Tag *const tag, const enum Write_TagType type
+write_journal(
+	const struct OpenFiles *const openfiles, const uint8_t *const towrite,
+	const size_t bitlen
 )
 /*@globals	fileSystem,
 		internalState
 @*/
 /*@modifies	fileSystem,
-		internalState,
-		*info
+		internalState
 @*/
 {
-	uint8_t *buf = NULL;
-	uint32_t size_items;
-	off_t off_items, off_end;
+	enum GatepaErr err;
+	size_t idx;
+
+	idx = 0;
+	goto loop_entr;
+	do {	err = journal_batch_add(
+			openfiles->name[idx], openfiles->fd[idx],
+			&openfiles->info[idx], openfiles->disk[idx]
+		);
+		if ( err != 0 ){
+			return err;
+		}
+		idx += 1u;
+loop_entr:
+		idx  = bitset_find_1(towrite, bitlen, idx);
+	} while ( idx != SIZE_MAX );
+
+	return journal_batch_sync();
+}
+
+/* flushes a file that was just written, or with --sync=batch, only starts
+     writing back its tag
+*/
+/* returns 0 on success */
+static enum GatepaErr
+write_sync_file(const nbufio_fd fd, const off_t off_begin)
+/*@globals	fileSystem,
+		g_apetag
+@*/
+/*@modifies	fileSystem@*/
+{
+	int err = 0;
+
+	switch ( g_apetag.sync ){
+	case WRITESYNC_NONE:
+		break;
+	case WRITESYNC_BATCH:
+		err = nbufio_datasync_start(fd, off_begin, 0);
+		break;
+	case WRITESYNC_FILE:
+		err = nbufio_datasync(fd);
+		break;
+	}
+	return (err == 0 ? 0 : GATERR_IO_SYNC);
+}
+
+/* whether the file already holds the tag as it would be written; this
+     only holds for a tag that no mode has changed since it was read, and
+     that was read from a tag framed as write/ frames it
+*/
+PURE
+static bool
+write_is_unchanged(
+	const struct OpenFiles *const openfiles, const size_t idx,
+	const enum Write_TagType type
+)
+/*@globals	g_apetag@*/
+{
+	const struct Gatepa_FileInfo *const info = &openfiles->info[idx];
+	const struct Gatepa_Tag      *const tag  = &openfiles->tag[idx];
+
+	if ( bitset_get(openfiles->dirty, idx) != 0 ){
+		return false;
+	}
+	if ( tag->nmemb == 0 ){
+		return info->off_end == NBUFIO_OFF_ERROR;
+	}
+	if ( (info->off_end == NBUFIO_OFF_ERROR)
+	    ||
+	     (!info->canonical)
+	    ||
+	     ((info->off_begin != info->off_items) != (type == TAGTYPE_LONG))
+	){
+		return false;
+	}
+	return (g_apetag.pad_size == 0) && (g_apetag.pad_percent == 0);
+}
+
+/* whether writing the file would change its bytes on disk */
+/* returns 0 on success */
+static enum GatepaErr
+write_differs(
+	/*@out@*/ bool *const differs, const struct OpenFiles *const openfiles,
+	const size_t idx, const enum Write_TagType type
+)
+/*@globals	internalState,
+		g_apetag
+@*/
+/*@modifies	internalState,
+		*differs
+@*/
+{
+	const struct Gatepa_FileInfo *const info = &openfiles->info[idx];
+	const struct Gatepa_Tag      *const tag  = &openfiles->tag[idx];
+	/*@null@*/
+	const uint8_t                *const disk = openfiles->disk[idx];
+	/* * */
+	uint8_t *buf;
+	size_t buf_size, pad_size;
+	enum GatepaErr err;
+
+	*differs = true;
+	if ( write_is_unchanged(openfiles, idx, type) ){
+		*differs = false;
+		return 0;
+	}
+	if ( tag->nmemb == 0 ){
+		*differs = (info->off_end != NBUFIO_OFF_ERROR);
+		return 0;
+	}
+	if ( disk == NULL ){
+		return 0;	/* nothing to diff against */
+	}
+
+	err = write_build(&buf, &buf_size, &pad_size, info, tag, type);
+	if ( err != 0 ){
+		return err;
+	}
+	if ( (size_t) (info->off_end - info->off_begin) == buf_size ){
+		*differs = (write_diff_prefix(buf, disk, buf_size) != buf_size);
+	}
+	return 0;
+}
+
+/* builds the new tag (header, items, padding, and footer) in the scratch
+     arena
+*/
+/* returns 0 on success */
+static enum GatepaErr
+write_build(
+	/*@out@*/ uint8_t **const buf_out, /*@out@*/ size_t *const size_out,
+	/*@out@*/ size_t *const pad_size_out,
+	const struct Gatepa_FileInfo *const info,
+	const struct Gatepa_Tag *const tag, const enum Write_TagType type
+)
+/*@globals	internalState,
+		g_apetag
+@*/
+/*@modifies	internalState,
+		*buf_out,
+		*size_out,
+		*pad_size_out
+@*/
+{
+	uint8_t *buf;
+	uint32_t size_items, nmemb;
+	size_t hdr_size, pad_size, buf_size;
 	union {	int		i;
 		size_t		z;
-		off_t		o;
 		enum GatepaErr	gat;
 	} err;
 
 	/* calculate the collective size of the tag items */
 	err.gat = apetag_size_items(&size_items, tag);
 	if ( err.gat != 0 ){
-		/*@-mustmod@*/
+		/*@-mustdefine@*/
 		return err.gat;
-		/*@=mustmod@*/
+		/*@=mustdefine@*/
 	}
 	err.i = add_u32_overflow(
 		&size_items, size_items,
 		(uint32_t) sizeof(struct ApeTag_TagHF)
 	);
 	if ( err.i != 0 ){
-		/*@-mustmod@*/
+		/*@-mustdefine@*/
 		return GATERR_OVERFLOW;
-		/*@=mustmod@*/
+		/*@=mustdefine@*/
+	}
+
+	/* reserve some padding */
+	hdr_size = (type == TAGTYPE_LONG ? sizeof(struct ApeTag_TagHF) : 0);
+	pad_size = write_pad_size(info, hdr_size + size_items);
+	if ( pad_size > (size_t) UINT32_MAX ){
+		/*@-mustdefine@*/
+		return GATERR_OVERFLOW;
+		/*@=mustdefine@*/
+	}
+	err.i = add_u32_overflow(&size_items, size_items, (uint32_t) pad_size);
+	if ( err.i != 0 ){
+		/*@-mustdefine@*/
+		return GATERR_OVERFLOW;
+		/*@=mustdefine@*/
+	}
+	nmemb = tag->nmemb + (uint32_t) (pad_size != 0);
+
+	/* allocate a buffer */
+	buf_size = hdr_size + size_items;
+	err.i    = gatepa_alloc_scratch_reset();
+	if ( err.i != 0 ){
+		/*@-mustdefine@*/
+		return GATERR_ALLOCATOR;
+		/*@=mustdefine@*/
 	}
+	buf = gatepa_alloc_scratch(buf_size, (size_t) 1u);
+	if ( buf == NULL ){
+		/*@-mustdefine@*/
+		return GATERR_ALLOCATOR;
+		/*@=mustdefine@*/
+	}
+	assert(buf != NULL);
+
+	/* construct the new tag */
+	if ( type == TAGTYPE_LONG ){
+		err.z = apetag_construct_tag_header(buf, size_items, nmemb);
+		assert(err.z == hdr_size);
+	}
+	err.z = apetag_construct_tag(
+		&buf[hdr_size], (size_t) size_items, tag, type, pad_size
+	);
+	assert(err.z == (size_t) size_items);
+
+	*buf_out      = buf;
+	*size_out     = buf_size;
+	*pad_size_out = pad_size;
+	return 0;
+}
+
+/* *disk is the tag as it is on disk (or NULL if unknown), and is reset
+     to NULL once the file is written
+*/
+/* the tag is rebuilt here rather than kept from write_differs(), so that
+     only one tag at a time is held in memory
+*/
+/* returns 0 on success */
+static enum GatepaErr
+write_single(
+	const nbufio_fd fd, struct Gatepa_FileInfo *const info,
+	const uint8_t **const disk, const struct Gatepa_Tag *const tag,
+	const enum Write_TagType type
+)
+/*@globals	fileSystem,
+		internalState,
+		g_apetag
+@*/
+/*@modifies	fileSystem,
+		internalState,
+		*info,
+		*disk
+@*/
+{
+	uint8_t *buf = NULL;
+	uint32_t size_items, nmemb;
+	size_t hdr_size, pad_size, buf_size, size_old, size_same = 0;
+	off_t off_items, off_end;
+	union {	int		i;
+		size_t		z;
+		enum GatepaErr	gat;
+	} err;
 
 	/* write-lock file */
 	err.i = nbufio_lock(fd, LOCK_EX | LOCK_NB);
@@ -214,85 +594,134 @@ write_single(
 
 			*info = gatepa_fileinfo_make(
 				0, 0, info->off_begin, NBUFIO_OFF_ERROR,
-				NBUFIO_OFF_ERROR
+				NBUFIO_OFF_ERROR, false
 			);
+			*disk = NULL;
 		}
 		/*@-mustmod@*/
 		return 0;
 		/*@=mustmod@*/
 	}
 
-	/* allocate a buffer */
-	err.i = gatepa_alloc_scratch_reset();
-	if ( err.i != 0 ){
+	/* construct the new tag */
+	err.gat = write_build(&buf, &buf_size, &pad_size, info, tag, type);
+	if ( err.gat != 0 ){
 		/*@-mustmod@*/
-		return GATERR_ALLOCATOR;
+		return err.gat;
 		/*@=mustmod@*/
 	}
-	buf = gatepa_alloc_scratch((size_t) size_items, (size_t) 1u);
-	if ( buf == NULL ){
-		/*@-mustmod@*/
-		return GATERR_ALLOCATOR;
-		/*@=mustmod@*/
+	hdr_size   = (type == TAGTYPE_LONG ? sizeof(struct ApeTag_TagHF) : 0);
+	size_items = (uint32_t) (buf_size - hdr_size);
+	nmemb      = tag->nmemb + (uint32_t) (pad_size != 0);
+
+	/* skip the bytes that are already on disk */
+	if ( *disk != NULL ){
+		size_old  = (size_t) (info->off_end - info->off_begin);
+		size_same = write_diff_prefix(buf, *disk, (buf_size < size_old
+			? buf_size : size_old
+		));
 	}
-	assert(buf != NULL);
 
-	/* construct the new tag */
-	err.z = apetag_construct_tag(buf, (size_t) size_items, tag, type);
-	assert(err.z == (size_t) size_items);
+	/* overwrite the old tag in place (off_begin is the EOF if there was
+	     none), so only a shrinking tag needs a truncate
+	*/
+	/* if we fail beyond here, remove the tag.
+	   saving the old tag beforehand and then rewriting it on error may be
+	     viable, but if writing failed, more writing will likely also fail
+	*/
+	*disk = NULL;
+	if ( size_same != buf_size ){
+		err.z = nbufio_pwrite(
+			fd, &buf[size_same], buf_size - size_same,
+			info->off_begin + (off_t) size_same
+		);
+		if ( err.z != buf_size - size_same ){
+			(void) nbufio_truncate(fd, info->off_begin);
+			/*@-mustmod@*/
+			return GATERR_IO_WRITE;
+			/*@=mustmod@*/
+		}
+	}
+	off_items = info->off_begin + (off_t) hdr_size;
+	off_end   = info->off_begin + (off_t) buf_size;
 
-	if ( info->off_end != NBUFIO_OFF_ERROR ){
-		/* remove the old tag */
-		err.i = nbufio_truncate(fd, info->off_begin);
+	if ( (info->off_end != NBUFIO_OFF_ERROR) && (off_end < info->off_end) ){
+		/* remove the rest of the old tag */
+		err.i = nbufio_truncate(fd, off_end);
 		if ( err.i != 0 ){
+			(void) nbufio_truncate(fd, info->off_begin);
 			/*@-mustmod@*/
 			return GATERR_IO_TRUNCATE;
 			/*@=mustmod@*/
 		}
 	}
 
-	/* seek to the end of the file */
-	err.o = nbufio_seek(fd, 0, SEEK_END);
-	if ( err.o == NBUFIO_OFF_ERROR ){
-		/*@-mustmod@*/
-		return GATERR_IO_SEEK;
-		/*@=mustmod@*/
-	}
-	assert(nbufio_tell(fd) == info->off_begin);
+	/* a padding item is dropped when the tag is read back */
+	*info = gatepa_fileinfo_make(
+		size_items, nmemb, info->off_begin, off_end, off_items,
+		pad_size == 0
+	);
+	return 0;
+}
 
-	/* if we fail beyond here, remove the tag.
-	   saving the old tag beforehand and then rewriting it on error may be
-	     viable, but if writing failed, more writing will likely also fail
-	*/
+/* returns the length of the common prefix of a and b */
+PURE
+static size_t
+write_diff_prefix(
+	const uint8_t *const a, const uint8_t *const b, const size_t size
+)
+/*@*/
+{
+	size_t i;
 
-	if ( type == TAGTYPE_LONG ){
-		/* write the new tag header */
-		err.gat = apetag_write_tag_header(fd, size_items, tag->nmemb);
-		if ( err.gat != 0 ){
-			(void) nbufio_truncate(fd, info->off_begin);
-			/*@-mustmod@*/
-			return err.gat;
-			/*@=mustmod@*/
+	for ( i = 0; i < size; ++i ){
+		if ( a[i] != b[i] ){
+			break;
 		}
 	}
-	off_items = nbufio_tell(fd);
-	assert(off_items != NBUFIO_OFF_ERROR);
+	return i;
+}
 
-	/* write the new tag items+footer */
-	err.z = nbufio_write(fd, buf, size_items);
-	if ( err.z == NBUFIO_RW_ERROR ){
-		(void) nbufio_truncate(fd, info->off_begin);
-		/*@-mustmod@*/
-		return GATERR_IO_WRITE;
-		/*@=mustmod@*/
+/* returns the size of the padding item to write (0 for none) */
+/* an old tag with enough spare room is filled exactly, so that the write
+     neither extends nor truncates the file; without --pad-size or
+     --pad-percent, all of that room is kept
+*/
+PURE
+static size_t
+write_pad_size(
+	const struct Gatepa_FileInfo *const info, const size_t size_needed
+)
+/*@globals	g_apetag@*/
+{
+	size_t pad_size, size_old = 0;
+
+	if ( info->off_end != NBUFIO_OFF_ERROR ){
+		size_old = (size_t) (info->off_end - info->off_begin);
 	}
-	off_end = nbufio_tell(fd);
-	assert(off_items != NBUFIO_OFF_ERROR);
 
-	*info = gatepa_fileinfo_make(
-		size_items, tag->nmemb, info->off_begin, off_end, off_items
+	pad_size = (size_t) ((uint64_t) size_needed * g_apetag.pad_percent
+		/ 100u
 	);
-	return 0;
+	pad_size = (pad_size > g_apetag.pad_size
+		? pad_size : (size_t) g_apetag.pad_size
+	);
+	if ( pad_size == 0 ){
+		return (size_old >= size_needed + GATEPA_PADDING_MIN
+			? size_old - size_needed : 0
+		);
+	}
+	pad_size = (pad_size > GATEPA_PADDING_MIN
+		? pad_size : GATEPA_PADDING_MIN
+	);
+
+	if ( (size_old >= size_needed + GATEPA_PADDING_MIN)
+	    &&
+	     (size_old <= size_needed + pad_size)
+	){
+		return size_old - size_needed;
+	}
+	return pad_size;
 }
 
 /* EOF //////////////////////////////////////////////////////////////////// */
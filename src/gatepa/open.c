@@ -11,9 +11,14 @@
 
 #include <errno.h>
 #include <limits.h>
+#include <pthread.h>
+#include <stdatomic.h>
+#include <string.h>
 
+#include <sys/mman.h>
 #include <sys/resource.h>
 
+#include <libs/bitset.h>
 #include <libs/nbufio.h>
 #include <libs/overflow.h>
 
@@ -25,11 +30,40 @@
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+/* opt_g_open_strtol() and opt_g_open_flag() depend on field order */
+/*@checkmod@*/
+struct Open_Globals g_open = {
+	.window		= UINT32_MAX,
+	.jobs		= UINT32_C(1),
+	.tail_size	= UINT32_C(65536),
+	.io_uring	= false
+};
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+/* shared by the open_files() worker threads */
+struct OpenJobs {
+	/*@temp@*/
+	struct OpenFiles	*openfiles;
+	/*@temp@*/
+	const char		**errstr;	/* per-file, NULL on success */
+	atomic_uint		idx_next;
+	unsigned int		num_files;
+};
+
+struct OpenJobsWorker {
+	/*@temp@*/
+	struct OpenJobs		*jobs;
+	/*@temp@*/
+	struct Alloc_Ctx	*ctx;
+	pthread_t		thread;
+};
+
+/* //////////////////////////////////////////////////////////////////////// */
+
 #undef openfiles
-static int
-open_files_loop_body(
-	/*@partial@*/ struct OpenFiles *openfiles, const char *const *,
-	unsigned int
+static int open_files_parallel(
+	/*@partial@*/ struct OpenFiles *openfiles, unsigned int, unsigned int
 )
 /*@globals	fileSystem,
 		internalState
@@ -40,6 +74,63 @@ open_files_loop_body(
 @*/
 ;
 
+#undef openfiles
+static int open_files_ring(
+	/*@partial@*/ struct OpenFiles *openfiles, unsigned int
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState,
+		*openfiles
+@*/
+;
+
+static int open_files_report(
+	const struct OpenFiles *, const char *const *, unsigned int
+)
+/*@globals	fileSystem@*/
+/*@modifies	fileSystem@*/
+;
+
+/*@null@*/
+static void *open_files_worker(void *)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+;
+
+#undef openfiles
+/*@observer@*/ /*@null@*/
+static const char *open_files_loop_body(
+	/*@partial@*/ struct OpenFiles *openfiles, unsigned int
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState,
+		*openfiles
+@*/
+;
+
+#undef openfiles
+/*@observer@*/ /*@null@*/
+static const char *open_file_tag_tail(
+	/*@partial@*/ struct OpenFiles *openfiles, unsigned int
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	internalState,
+		*openfiles
+@*/
+;
+
 /* returns 0 on success */
 static int fdlimit_check(void)
 /*@globals	internalState@*/
@@ -63,22 +154,25 @@ gatepa_print_filename(
 		*file
 @*/
 {
-	const int pow10 = (int) ilog10p1((uintmax_t) openfiles->nmemb);
+	const int pow10 = (int) ilog10p1((uintmax_t) openfiles->nmemb_total);
 
-	assert(idx < UINT_MAX);
+	assert(openfiles->idx_base + idx < UINT_MAX);
 
 	(void) fprintf(file, "%0*u:%08zX:'%s'\n",
-		pow10, idx + 1u, (size_t) openfiles->info[idx].off_begin,
+		pow10, openfiles->idx_base + idx + 1u,
+		(size_t) openfiles->info[idx].off_begin,
 		openfiles->name[idx]
 	);
 	return;
 }
 
+/* opens the window of files [idx_base, idx_base + num_files) */
 /* returns 0 on success, <0 on allocator err, or the number of file errs */
 GATEPA int
 open_files(
 	/*@out@*/ struct OpenFiles *const openfiles,
-	const unsigned int num_files, const char *const *const file0
+	const unsigned int num_files, const char *const *const file0,
+	const unsigned int idx_base, const unsigned int num_files_total
 )
 /*@globals	fileSystem,
 		internalState
@@ -90,9 +184,18 @@ open_files(
 {
 	int retval = 0;
 	void *ptr_fd, *ptr_info, *ptr_tag;
-	int err;
+	struct OpenMap *ptr_map = NULL;
+	uint8_t *ptr_dirty;
+	const uint8_t **ptr_disk;
+	const char *errstr;
+	unsigned int num_jobs;
 	unsigned int i;
 
+	assert((idx_base < num_files_total)
+	      &&
+	       (num_files <= num_files_total - idx_base)
+	);
+
 	/* alloc */
 	ptr_fd = gatepa_alloc_a16(
 		sizeof *openfiles->fd, (size_t) num_files
@@ -103,30 +206,69 @@ open_files(
 	ptr_tag = gatepa_alloc_a16(
 		sizeof *openfiles->tag, (size_t) num_files
 	);
-	if ( (ptr_fd == NULL) || (ptr_info == NULL) || (ptr_tag == NULL) ){
+	ptr_dirty = gatepa_alloc_a16(
+		sizeof *ptr_dirty, BITSET_BYTELEN(num_files)
+	);
+	ptr_disk = gatepa_alloc_a16(
+		sizeof *ptr_disk, (size_t) num_files
+	);
+	if ( (ptr_fd == NULL) || (ptr_info == NULL) || (ptr_tag == NULL)
+	    ||
+	     (ptr_dirty == NULL) || (ptr_disk == NULL)
+	){
 		/*@-mustdefine@*/ /*@-mustmod@*/
 		return -1;
 		/*@=mustdefine@*/ /*@=mustmod@*/
 	}
+	(void) memset(ptr_dirty, 0x00, BITSET_BYTELEN(num_files));
+	for ( i = 0; i < num_files; ++i ){
+		ptr_disk[i] = NULL;
+	}
+	if ( g_open.mmap ){
+		ptr_map = gatepa_alloc_a16(sizeof *ptr_map, (size_t) num_files);
+		if ( ptr_map == NULL ){
+			/*@-mustdefine@*/ /*@-mustmod@*/
+			return -1;
+			/*@=mustdefine@*/ /*@=mustmod@*/
+		}
+		for ( i = 0; i < num_files; ++i ){
+			ptr_map[i] = (struct OpenMap) { NULL, 0 };
+		}
+	}
 
 	/* init */
 	*openfiles = (struct OpenFiles) {
-		ptr_fd, ptr_info, ptr_tag, file0, 0
+		ptr_fd, ptr_info, ptr_tag, &file0[idx_base], ptr_map,
+		ptr_dirty, ptr_disk, num_files, num_files_total, idx_base
 	};
 
 	/* fill */
+	if ( g_open.io_uring && !g_open.mmap ){
+		return open_files_ring(openfiles, num_files);
+	}
+	num_jobs = (g_open.jobs < OPEN_JOBS_MAX ? g_open.jobs : OPEN_JOBS_MAX);
+	num_jobs = (num_jobs < num_files ? num_jobs : num_files);
+	if ( num_jobs > 1u ){
+		return open_files_parallel(openfiles, num_files, num_jobs);
+	}
 	for ( i = 0; i < num_files; ++i ){
-		err = open_files_loop_body(openfiles, file0, i);
-		retval += (retval != INT_MAX ? (int) (err != 0) : 0);
+		errstr = open_files_loop_body(openfiles, i);
+		if UNLIKELY ( errstr != NULL ){
+			gatepa_error("%s: '%s'", errstr, openfiles->name[i]);
+			retval += (retval != INT_MAX ? 1 : 0);
+		}
 	}
 	return retval;
 }
 
-/* MAYBE: pass argv_idx for error printing */
+/* each worker thread allocates from its own arenas, which get handed to the
+     main thread afterwards, and then it reports the errors in argv order
+*/
+/* returns 0 on success, <0 on allocator err, or the number of file errs */
 static int
-open_files_loop_body(
+open_files_parallel(
 	/*@partial@*/ struct OpenFiles *const openfiles,
-	const char *const *const file0, const unsigned int idx
+	const unsigned int num_files, const unsigned int num_jobs
 )
 /*@globals	fileSystem,
 		internalState
@@ -136,61 +278,505 @@ open_files_loop_body(
 		*openfiles
 @*/
 {
-	nbufio_fd fd;
+	struct OpenJobs jobs;
+	struct OpenJobsWorker *worker;
+	const char **errstr;
+	int err;
+	unsigned int i;
+
+	assert(num_jobs > 1u);
+
+	/* alloc */
+	err = gatepa_alloc_jobs_init(num_jobs);
+	errstr = gatepa_alloc_a16(sizeof *errstr, (size_t) num_files);
+	worker = gatepa_alloc_a16(sizeof *worker, (size_t) num_jobs);
+	if ( (err != 0) || (errstr == NULL) || (worker == NULL) ){
+		return -1;
+	}
+
+	/* init */
+	jobs.openfiles = openfiles;
+	jobs.errstr    = errstr;
+	atomic_init(&jobs.idx_next, 0u);
+	jobs.num_files = num_files;
+
+	/* the main thread is the last worker */
+	for ( i = 0; i < num_jobs; ++i ){
+		worker[i].jobs = &jobs;
+		worker[i].ctx  = gatepa_alloc_ctx_job(i);
+	}
+	for ( i = 0; i < num_jobs - 1u; ++i ){
+		err = pthread_create(
+			&worker[i].thread, NULL, open_files_worker, &worker[i]
+		);
+		if ( err != 0 ){
+			break;	/* the rest of the workers pick up the slack */
+		}
+	}
+	(void) open_files_worker(&worker[num_jobs - 1u]);
+	(void) gatepa_alloc_ctx_select(NULL);
+	while ( i-- != 0 ){
+		(void) pthread_join(worker[i].thread, NULL);
+	}
+
+	/* hand the tags to the main thread's arenas */
+	err = 0;
+	for ( i = 0; i < num_jobs; ++i ){
+		err |= gatepa_alloc_ctx_handoff(worker[i].ctx);
+	}
+	if ( err != 0 ){
+		return -1;
+	}
+
+	return open_files_report(openfiles, errstr, num_files);
+}
+
+/* reads every footer in one batch, then every header + items blob in a
+     second batch, instead of seeking/reading each file in turn
+*/
+/* returns 0 on success, <0 on allocator err, or the number of file errs */
+static int
+open_files_ring(
+	/*@partial@*/ struct OpenFiles *const openfiles,
+	const unsigned int num_files
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState,
+		*openfiles
+@*/
+{
+	const size_t hf_size = sizeof(struct ApeTag_TagHF);
+	/* * */
+	struct NBufIO_Ring ring;
+	struct NBufIO_Ring *ring_ptr;
+	struct NBufIO_ReadReq *req;
+	struct ApeTag_TagHF *footer;
+	struct ApeTag_TagHF header;
+	unsigned int *req_file;
+	const char **errstr;
+	uint8_t *buf;
+	unsigned int num_req = 0, num_req_next;
+	unsigned int i, r;
+	size_t hdr_size;
+	off_t off_end;
 	union {	int			i;
 		enum GatepaErr		gat;
 		enum TagCheckError	tagcheck;
 		enum SlurpError		slurp;
 	} err;
 
-	/* open/read-lock the file */
-	err.gat = open_file(&fd, file0[idx]);
-	if UNLIKELY ( err.gat != 0 ){
-		/* MAYBE: use errno */
-		gatepa_error("%s: '%s'",
-			gatepa_strerror(err.gat), file0[idx]
+	/* alloc */
+	errstr   = gatepa_alloc_a16(sizeof *errstr,   (size_t) num_files);
+	req      = gatepa_alloc_a16(sizeof *req,      (size_t) num_files);
+	req_file = gatepa_alloc_a16(sizeof *req_file, (size_t) num_files);
+	footer   = gatepa_alloc_a16(sizeof *footer,   (size_t) num_files);
+	if ( (errstr == NULL) || (req == NULL) || (req_file == NULL)
+	    ||
+	     (footer == NULL)
+	){
+		return -1;
+	}
+
+	/* open/read-lock each file, and queue its footer read */
+	for ( i = 0; i < num_files; ++i ){
+		errstr[i] = NULL;
+		openfiles->tag[i] = GATEPA_MEMTAG_INIT;
+
+		err.gat = open_file(&openfiles->fd[i], openfiles->name[i]);
+		if ( err.gat != 0 ){
+			errstr[i] = gatepa_strerror(err.gat);
+			continue;
+		}
+		off_end = nbufio_seek(openfiles->fd[i], 0, SEEK_END);
+		if ( (off_end == NBUFIO_OFF_ERROR)
+		    ||
+		     (off_end < (off_t) hf_size)
+		){
+			errstr[i] = gatepa_strerror_tagcheck(TAGCHECK_ERR_SEEK);
+			continue;
+		}
+		req[num_req] = (struct NBufIO_ReadReq) {
+			openfiles->fd[i], off_end - (off_t) hf_size,
+			&footer[i], hf_size, 0
+		};
+		req_file[num_req++] = i;
+	}
+
+	err.i    = nbufio_ring_init(&ring, (num_files < OPEN_RING_ENTRIES
+		? num_files : OPEN_RING_ENTRIES
+	));
+	ring_ptr = (err.i == 0 ? &ring : NULL);
+
+	/* batch 1: the footers */
+	(void) nbufio_pread_batch(ring_ptr, req, (size_t) num_req);
+
+	/* check each footer, and queue its header + items read */
+	num_req_next = 0;
+	for ( r = 0; r < num_req; ++r ){
+		i = req_file[r];
+		if ( req[r].result != hf_size ){
+			errstr[i] = gatepa_strerror_tagcheck(
+				req[r].result != NBUFIO_RW_ERROR
+					? TAGCHECK_ERR_READ_EOF
+					: TAGCHECK_ERR_READ
+			);
+			continue;
+		}
+		err.tagcheck = apetag_tag_check_footer(
+			&openfiles->info[i], &footer[i],
+			req[r].offset + (off_t) hf_size
+		);
+		if ( err.tagcheck == TAGCHECK_ERR_PREAMBLE ){
+			continue;	/* tagless */
+		}
+		if UNLIKELY ( err.tagcheck != 0 ){
+			errstr[i] = gatepa_strerror_tagcheck(err.tagcheck);
+			continue;
+		}
+
+		hdr_size = (openfiles->info[i].items_size > (uint32_t) hf_size
+			? hf_size : 0
+		);
+		if ( openfiles->info[i].off_items < (off_t) hdr_size ){
+			errstr[i] = gatepa_strerror_tagcheck(TAGCHECK_ERR_SEEK);
+			continue;
+		}
+		buf = gatepa_alloc_a1(
+			hdr_size + openfiles->info[i].items_size, (size_t) 1u
 		);
+		if ( buf == NULL ){
+			errstr[i] = gatepa_strerror_slurp(SLURP_ERR_ALLOCATOR);
+			continue;
+		}
+		req[num_req_next] = (struct NBufIO_ReadReq) {
+			openfiles->fd[i],
+			openfiles->info[i].off_items - (off_t) hdr_size,
+			buf, hdr_size + openfiles->info[i].items_size, 0
+		};
+		req_file[num_req_next++] = i;
+	}
+	num_req = num_req_next;
+
+	/* batch 2: the headers + items */
+	(void) nbufio_pread_batch(ring_ptr, req, (size_t) num_req);
+	if ( ring_ptr != NULL ){
+		nbufio_ring_fini(ring_ptr);
 	}
-	openfiles->fd[idx] = fd;
-	openfiles->nmemb  += 1u;
 
+	/* check each header, and slurp each tag */
+	for ( r = 0; r < num_req; ++r ){
+		i   = req_file[r];
+		buf = req[r].buf;
+		if ( req[r].result != req[r].count ){
+			errstr[i] = gatepa_strerror_slurp(
+				req[r].result != NBUFIO_RW_ERROR
+					? SLURP_ERR_READ_EOF
+					: SLURP_ERR_READ_SYS
+			);
+			continue;
+		}
+		hdr_size = req[r].count - openfiles->info[i].items_size;
+		if ( hdr_size != 0 ){
+			(void) memcpy(&header, buf, sizeof header);
+			err.tagcheck = apetag_tag_check_header(
+				&openfiles->info[i], &footer[i], &header
+			);
+			if ( (err.tagcheck != 0)
+			    &&
+			     (err.tagcheck != TAGCHECK_ERR_MISMATCHED)
+			){
+				errstr[i] = gatepa_strerror_tagcheck(
+					err.tagcheck
+				);
+				continue;
+			}
+		}
+
+		err.slurp = apetag_slurp_tag_blob(
+			&openfiles->tag[i], &openfiles->info[i], &buf[hdr_size]
+		);
+		if UNLIKELY ( err.slurp != 0 ){
+			errstr[i] = gatepa_strerror_slurp(err.slurp);
+			continue;
+		}
+		openfiles->disk[i] = &buf[
+			openfiles->info[i].off_begin - req[r].offset
+		];
+	}
+
+	return open_files_report(openfiles, errstr, num_files);
+}
+
+/* prints the errors in argv order */
+/* returns the number of file errs */
+static int
+open_files_report(
+	const struct OpenFiles *const openfiles,
+	const char *const *const errstr, const unsigned int num_files
+)
+/*@globals	fileSystem@*/
+/*@modifies	fileSystem@*/
+{
+	int retval = 0;
+	unsigned int i;
+
+	for ( i = 0; i < num_files; ++i ){
+		if UNLIKELY ( errstr[i] != NULL ){
+			gatepa_error("%s: '%s'", errstr[i], openfiles->name[i]);
+			retval += (retval != INT_MAX ? 1 : 0);
+		}
+	}
+	return retval;
+}
+
+/*@null@*/
+static void *
+open_files_worker(void *const arg)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+{
+	struct OpenJobsWorker *const worker = arg;
+	struct OpenJobs       *const jobs   = worker->jobs;
+	/* * */
+	unsigned int idx;
+
+	(void) gatepa_alloc_ctx_select(worker->ctx);
+
+	for ( ;; ){
+		idx = atomic_fetch_add(&jobs->idx_next, 1u);
+		if ( idx >= jobs->num_files ){
+			break;
+		}
+		jobs->errstr[idx] = open_files_loop_body(jobs->openfiles, idx);
+	}
+	return NULL;
+}
+
+/* MAYBE: pass argv_idx for error printing */
+/* returns NULL on success, or the error string */
+/*@observer@*/ /*@null@*/
+static const char *
+open_files_loop_body(
+	/*@partial@*/ struct OpenFiles *const openfiles, const unsigned int idx
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState,
+		*openfiles
+@*/
+{
+	nbufio_fd fd;
+	union {	int			i;
+		enum GatepaErr		gat;
+		enum TagCheckError	tagcheck;
+		enum SlurpError		slurp;
+	} err;
+
+	/* open/read-lock the file */
+	/* MAYBE: use errno */
+	err.gat = open_file(&fd, openfiles->name[idx]);
+	openfiles->fd[idx] = fd;
 	if ( err.gat != 0 ){
-		return -1;
+		return gatepa_strerror(err.gat);
 	}
 	assert(fd != NBUFIO_FD_ERROR);
 
-	/* check the tag */
-	err.tagcheck = apetag_file_tag_check_eof(&openfiles->info[idx], fd);
-	switch ( err.tagcheck ){
-	case TAGCHECK_ERR_PREAMBLE:
+	return open_file_tag_tail(openfiles, idx);
+}
+
+/* reads the tail of the file in one go, and parses the footer, header, and
+     items from that; a second read is only needed if the tag doesn't fit
+*/
+/* with --mmap, the whole file is mapped instead, and the tag references the
+     mapping directly
+*/
+/* returns NULL on success, or the error string */
+/*@observer@*/ /*@null@*/
+static const char *
+open_file_tag_tail(
+	/*@partial@*/ struct OpenFiles *const openfiles, const unsigned int idx
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	internalState,
+		*openfiles
+@*/
+{
+	const size_t hf_size = sizeof(struct ApeTag_TagHF);
+	const nbufio_fd fd   = openfiles->fd[idx];
+	struct Gatepa_FileInfo *const info = &openfiles->info[idx];
+	/* * */
+	struct ApeTag_TagHF footer, header;
+	uint8_t *tail = NULL, *buf;
+	size_t tail_size, hdr_size, buf_size, result;
+	off_t off_end, off_tail, off_buf;
+	union {	int			i;
+		enum TagCheckError	tagcheck;
+		enum SlurpError		slurp;
+	} err;
+
+	off_end = nbufio_seek(fd, 0, SEEK_END);
+	if ( (off_end == NBUFIO_OFF_ERROR) || (off_end < (off_t) hf_size) ){
+		return gatepa_strerror_tagcheck(TAGCHECK_ERR_SEEK);
+	}
+
+	/* map the file */
+	if ( (openfiles->map != NULL) && ((uintmax_t) off_end <= SIZE_MAX) ){
+		tail_size = (size_t) off_end;
+		off_tail  = 0;
+		tail      = mmap(
+			NULL, tail_size, PROT_READ | PROT_WRITE, MAP_PRIVATE,
+			fd, 0
+		);
+		if ( tail != MAP_FAILED ){
+			openfiles->map[idx] = (struct OpenMap) {
+				tail, tail_size
+			};
+		}
+		else {	tail = NULL;	/* fall back to reading */
+		}
+	}
+
+	/* or read the tail */
+	if ( tail == NULL ){
+		tail_size = (g_open.tail_size > hf_size
+			? g_open.tail_size : hf_size
+		);
+		tail_size = ((uintmax_t) tail_size < (uintmax_t) off_end
+			? tail_size : (size_t) off_end
+		);
+		off_tail  = off_end - (off_t) tail_size;
+		/* * */
+		err.i = gatepa_alloc_scratch_reset();
+		tail  = gatepa_alloc_scratch(tail_size, (size_t) 1u);
+		if ( (err.i != 0) || (tail == NULL) ){
+			return gatepa_strerror_slurp(SLURP_ERR_ALLOCATOR);
+		}
+		result = nbufio_pread(fd, tail, tail_size, off_tail);
+		if ( result != tail_size ){
+			return gatepa_strerror_tagcheck(
+				result != NBUFIO_RW_ERROR
+					? TAGCHECK_ERR_READ_EOF
+					: TAGCHECK_ERR_READ
+			);
+		}
+	}
+
+	/* check the footer */
+	(void) memcpy(&footer, &tail[tail_size - hf_size], hf_size);
+	err.tagcheck = apetag_tag_check_footer(info, &footer, off_end);
+	if ( err.tagcheck == TAGCHECK_ERR_PREAMBLE ){
 		openfiles->tag[idx] = GATEPA_MEMTAG_INIT;
-		return 0;
-	case TAGCHECK_ERR_MISMATCHED:
-		; /* MAYBE */
-		/*@switchbreak@*/ break;
-	default:
-		if UNLIKELY ( err.tagcheck != 0 ){
-			gatepa_error("%s: '%s'",
-				gatepa_strerror_tagcheck(err.tagcheck),
-				file0[idx]
+		return NULL;
+	}
+	if UNLIKELY ( err.tagcheck != 0 ){
+		return gatepa_strerror_tagcheck(err.tagcheck);
+	}
+
+	/* get the header + items, re-reading them if not in the tail */
+	hdr_size = (info->items_size > (uint32_t) hf_size ? hf_size : 0);
+	if ( info->off_items < (off_t) hdr_size ){
+		return gatepa_strerror_tagcheck(TAGCHECK_ERR_SEEK);
+	}
+	off_buf  = info->off_items - (off_t) hdr_size;
+	buf_size = hdr_size + info->items_size;
+	if ( (openfiles->map != NULL) && (openfiles->map[idx].addr == tail) ){
+		buf = &tail[off_buf];	/* zero-copy */
+		goto check_header;
+	}
+	buf = gatepa_alloc_a1(buf_size, (size_t) 1u);
+	if ( buf == NULL ){
+		return gatepa_strerror_slurp(SLURP_ERR_ALLOCATOR);
+	}
+	if ( off_buf >= off_tail ){
+		(void) memcpy(buf, &tail[off_buf - off_tail], buf_size);
+	}
+	else {	result = nbufio_pread(fd, buf, buf_size, off_buf);
+		if ( result != buf_size ){
+			return gatepa_strerror_slurp(result != NBUFIO_RW_ERROR
+				? SLURP_ERR_READ_EOF : SLURP_ERR_READ_SYS
 			);
-			return -1;
 		}
-		/*@switchbreak@*/ break;
+	}
+
+	/* check the header */
+check_header:
+	if ( hdr_size != 0 ){
+		(void) memcpy(&header, buf, hf_size);
+		err.tagcheck = apetag_tag_check_header(info, &footer, &header);
+		if ( (err.tagcheck != 0)
+		    &&
+		     (err.tagcheck != TAGCHECK_ERR_MISMATCHED)
+		){
+			return gatepa_strerror_tagcheck(err.tagcheck);
+		}
 	}
 
 	/* slurp the tag */
-	err.slurp = apetag_slurp_tag(
-		&openfiles->tag[idx], &openfiles->info[idx], fd
+	err.slurp = apetag_slurp_tag_blob(
+		&openfiles->tag[idx], info, &buf[hdr_size]
 	);
 	if UNLIKELY ( err.slurp != 0 ){
-		gatepa_error("%s: '%s'",
-			gatepa_strerror_slurp(err.slurp), file0[idx]
-		);
-		return -1;
+		return gatepa_strerror_slurp(err.slurp);
 	}
 
-	return 0;
+	/* keep the bytes of the tag for write/ to diff against */
+	openfiles->disk[idx] = &buf[info->off_begin - off_buf];
+	return NULL;
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* closes (and unlocks) every file in the window */
+/* returns 0 on success, or the number of file errs */
+GATEPA int
+close_files(struct OpenFiles *const openfiles)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState,
+		*openfiles
+@*/
+{
+	int retval = 0;
+	int err;
+	unsigned int i;
+
+	for ( i = 0; i < openfiles->nmemb; ++i ){
+		if ( openfiles->fd[i] == NBUFIO_FD_ERROR ){
+			continue;
+		}
+		if ( (openfiles->map != NULL)
+		    &&
+		     (openfiles->map[i].addr != NULL)
+		){
+			(void) munmap(
+				openfiles->map[i].addr, openfiles->map[i].size
+			);
+			openfiles->map[i] = (struct OpenMap) { NULL, 0 };
+		}
+		err = nbufio_close(openfiles->fd[i]);
+		if UNLIKELY ( err != 0 ){
+			gatepa_error("%s: '%s'",
+				gatepa_strerror(GATERR_IO_CLOSE),
+				openfiles->name[i]
+			);
+			retval += (retval != INT_MAX ? 1 : 0);
+		}
+		openfiles->fd[i] = NBUFIO_FD_ERROR;
+	}
+	return retval;
 }
 
 /* ------------------------------------------------------------------------ */
@@ -245,11 +831,10 @@ fdlimit_check(void)
 /*@globals	internalState@*/
 /*@modifies	internalState@*/
 {
-	static unsigned char tried = 0;
+	static atomic_flag tried = ATOMIC_FLAG_INIT;
 
-	if ( tried == 0 ){
+	if ( !atomic_flag_test_and_set(&tried) ){
 		fdlimit_try();
-		tried = (unsigned char) 1u;
 		return 0;
 	}
 	return -1;
@@ -19,6 +19,11 @@
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+/*@checkmod@*/ /*@unused@*/
+extern struct Open_Globals g_open;
+
+/* //////////////////////////////////////////////////////////////////////// */
+
 #undef file
 GATEPA_EXTERN void gatepa_print_filename(
 	FILE *file, const struct OpenFiles *, unsigned int
@@ -32,7 +37,7 @@ GATEPA_EXTERN void gatepa_print_filename(
 #undef openfiles
 GATEPA_EXTERN int open_files(
 	/*@out@*/ struct OpenFiles *openfiles,
-	unsigned int, const char *const *
+	unsigned int, const char *const *, unsigned int, unsigned int
 )
 /*@globals	fileSystem,
 		internalState
@@ -43,6 +48,17 @@ GATEPA_EXTERN int open_files(
 @*/
 ;
 
+#undef openfiles
+GATEPA_EXTERN int close_files(struct OpenFiles *openfiles)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState,
+		*openfiles
+@*/
+;
+
 #undef fd_out
 GATEPA_EXTERN enum GatepaErr open_file(
 	/*@out@*/ nbufio_fd *fd_out, const char *
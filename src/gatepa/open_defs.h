@@ -11,6 +11,8 @@
 //                                                                          //
 /////////////////////////////////////////////////////////////////////////// */
 
+#include <stdbool.h>
+#include <stdint.h>
 #include <stdio.h>
 
 #include <libs/nbufio.h>
@@ -24,6 +26,30 @@
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+/* opt_g_open_strtol() and opt_g_open_flag() depend on field order */
+struct Open_Globals {
+	uint32_t	window;		/* max number of files open at once */
+	uint32_t	jobs;		/* number of threads for opening    */
+	uint32_t	tail_size;	/* bytes read at once from the EOF  */
+	bool		io_uring;	/* batch the tag reads              */
+	bool		mmap;		/* map the files instead of reading */
+};
+
+#define OPEN_JOBS_MAX		64u
+#define OPEN_RING_ENTRIES	256u
+
+/* ======================================================================== */
+
+/* a private mapping of a whole file, which tags reference (--mmap) */
+struct OpenMap {
+	/*@null@*/ /*@owned@*/
+	uint8_t		*addr;
+	size_t		size;
+};
+
+/* ------------------------------------------------------------------------ */
+
+/* when processing in windows, the arrays only hold the current window */
 struct OpenFiles {
 	/*@temp@*/ /*@relnull@*/
 	nbufio_fd		*fd;
@@ -33,11 +59,21 @@ struct OpenFiles {
 	struct Gatepa_Tag	*tag;
 	/*@temp@*/ /*@relnull@*/
 	const char *const	*name;
+	/*@temp@*/ /*@null@*/
+	struct OpenMap		*map;		/* NULL unless --mmap       */
+	/*@temp@*/ /*@relnull@*/
+	uint8_t			*dirty;		/* bitset, changed tags     */
+	/*@temp@*/ /*@relnull@*/
+	const uint8_t		**disk;		/* tag as read, or NULL     */
 
 	unsigned int		nmemb;
+	unsigned int		nmemb_total;	/* all files on the cmdline */
+	unsigned int		idx_base;	/* cmdline index of [0]     */
 };
 
-#define OPENFILES_STATIC_INIT_NULL	{ NULL, NULL, NULL, NULL, 0 }
+#define OPENFILES_STATIC_INIT_NULL	{ \
+	NULL, NULL, NULL, NULL, NULL, NULL, NULL, 0, 0, 0 \
+}
 
 /* EOF //////////////////////////////////////////////////////////////////// */
 #endif	/* GATEPA_OPEN_DEFS_H */
@@ -11,14 +11,19 @@
 
 #include <assert.h>
 #include <errno.h>
+#include <stdbool.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
+#include "alloc.h"
 #include "apetag.h"
 #include "help.h"
+#include "journal.h"
 #include "mode.h"
+#include "open.h"
+#include "stats.h"
 
 /* //////////////////////////////////////////////////////////////////////// */
 
@@ -34,24 +39,99 @@ static int opt_g_apetag_strtol(unsigned int, /*@null@*/ const char *, size_t)
 /*@modifies	g_apetag@*/
 ;
 
+static int opt_g_open_strtol(unsigned int, /*@null@*/ const char *, size_t)
+/*@globals	g_open@*/
+/*@modifies	g_open@*/
+;
+
+static int opt_g_open_flag(unsigned int, /*@null@*/ const char *, size_t)
+/*@globals	g_open@*/
+/*@modifies	g_open@*/
+;
+
+static int opt_g_apetag_pad(unsigned int, /*@null@*/ const char *, size_t)
+/*@globals	g_apetag@*/
+/*@modifies	g_apetag@*/
+;
+
+static int opt_g_journal(unsigned int, /*@null@*/ const char *, size_t)
+/*@globals	g_journal@*/
+/*@modifies	g_journal@*/
+;
+
+static int opt_g_apetag_sync(unsigned int, /*@null@*/ const char *, size_t)
+/*@globals	g_apetag@*/
+/*@modifies	g_apetag@*/
+;
+
+static int opt_g_stats(unsigned int, /*@null@*/ const char *, size_t)
+/*@globals	internalState,
+		g_stats
+@*/
+/*@modifies	internalState,
+		g_stats
+@*/
+;
+
+static int opt_g_alloc(unsigned int, /*@null@*/ const char *, size_t)
+/*@globals	g_alloc@*/
+/*@modifies	g_alloc@*/
+;
+
+#undef value
+static int opt_strtou32(
+	/*@out@*/ uint32_t *value, /*@null@*/ const char *, size_t, bool
+)
+/*@modifies	*value@*/
+;
+
 /* //////////////////////////////////////////////////////////////////////// */
 
 typedef int (*gatepa_fnptr_opt)(
 	unsigned int, /*@null@*/ const char *, size_t
 );
 
-#define GATEPA_NUM_OPTS			5u
+#define GATEPA_NUM_OPTS			18u
 
 #define OPT_G_APETAG_STRTOL_START	1u
 #define OPT_G_APETAG_STRTOL_END		4u
 
+#define OPT_G_OPEN_STRTOL_START		5u
+#define OPT_G_OPEN_STRTOL_END		7u
+#define OPT_G_OPEN_WINDOW		5u
+
+#define OPT_G_OPEN_FLAG_START		8u
+#define OPT_G_OPEN_FLAG_END		9u
+
+#define OPT_G_APETAG_PAD_START		10u
+#define OPT_G_APETAG_PAD_END		11u
+
+#define OPT_G_JOURNAL_START		12u
+#define OPT_G_JOURNAL_END		13u
+
+#define OPT_G_ALLOC_START		16u
+#define OPT_G_ALLOC_END			17u
+
 /*@unchecked@*/ /*@observer@*/
 static const char *f_opt_name[GATEPA_NUM_OPTS] = {
 	"help",
 	"softlimit-items-size",
 	"softlimit-key-size",
 	"limit-binary-name",
-	"limit-binary-fext"
+	"limit-binary-fext",
+	"window",
+	"jobs",
+	"tail-size",
+	"io-uring",
+	"mmap",
+	"pad-size",
+	"pad-percent",
+	"journal",
+	"recover",
+	"sync",
+	"stats",
+	"arena-block",
+	"hugepages"
 };
 
 static const uint8_t f_opt_name_len[GATEPA_NUM_OPTS] = {
@@ -59,7 +139,20 @@ static const uint8_t f_opt_name_len[GATEPA_NUM_OPTS] = {
 	UINT8_C(20),	/* softlimit-items-size */
 	UINT8_C(18),	/* softlimit-key-size   */
 	UINT8_C(17),	/* limit-binary-name    */
-	UINT8_C(17)	/* limit-binary-fext    */
+	UINT8_C(17),	/* limit-binary-fext    */
+	UINT8_C( 6),	/* window               */
+	UINT8_C( 4),	/* jobs                 */
+	UINT8_C( 9),	/* tail-size            */
+	UINT8_C( 8),	/* io-uring             */
+	UINT8_C( 4),	/* mmap                 */
+	UINT8_C( 8),	/* pad-size             */
+	UINT8_C(11),	/* pad-percent          */
+	UINT8_C( 7),	/* journal              */
+	UINT8_C( 7),	/* recover              */
+	UINT8_C( 4),	/* sync                 */
+	UINT8_C( 5),	/* stats                */
+	UINT8_C(11),	/* arena-block          */
+	UINT8_C( 9)	/* hugepages            */
 };
 
 static const gatepa_fnptr_opt f_opt_fn[GATEPA_NUM_OPTS] = {
@@ -68,6 +161,35 @@ static const gatepa_fnptr_opt f_opt_fn[GATEPA_NUM_OPTS] = {
 	opt_g_apetag_strtol,
 	opt_g_apetag_strtol,
 	opt_g_apetag_strtol,
+	opt_g_open_strtol,
+	opt_g_open_strtol,
+	opt_g_open_strtol,
+	opt_g_open_flag,
+	opt_g_open_flag,
+	opt_g_apetag_pad,
+	opt_g_apetag_pad,
+	opt_g_journal,
+	opt_g_journal,
+	opt_g_apetag_sync,
+	opt_g_stats,
+	opt_g_alloc,
+	opt_g_alloc
+};
+
+/* ------------------------------------------------------------------------ */
+
+/* opts that can be set from the environment instead (argv overrides them) */
+#define GATEPA_NUM_ENV_OPTS		2u
+
+/*@unchecked@*/ /*@observer@*/
+static const char *f_env_name[GATEPA_NUM_ENV_OPTS] = {
+	"GATEPA_ARENA_BLOCK",
+	"GATEPA_HUGEPAGES"
+};
+
+static const uint8_t f_env_opt_idx[GATEPA_NUM_ENV_OPTS] = {
+	UINT8_C(16),	/* arena-block */
+	UINT8_C(17)	/* hugepages   */
 };
 
 /* //////////////////////////////////////////////////////////////////////// */
@@ -113,6 +235,43 @@ opt_process(const char *const arg)
 	return -1;
 }
 
+/* a flag opt is set by any value but "" and "0" */
+/* returns NULL on success, or the name of the bad variable */
+/*@observer@*/ /*@null@*/
+GATEPA const char *
+opt_process_env(void)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+{
+	const char *env;
+	unsigned int idx;
+	unsigned int i;
+	int err;
+
+	for ( i = 0; i < GATEPA_NUM_ENV_OPTS; ++i ){
+		env = getenv(f_env_name[i]);
+		if ( env == NULL ){
+			continue;
+		}
+		idx = (unsigned int) f_env_opt_idx[i];
+		if ( idx != OPT_G_ALLOC_END ){
+			err = f_opt_fn[idx](idx, env, strlen(env));
+		}
+		else if ( (env[0] != '\0') && (strcmp(env, "0") != 0) ){
+			err = f_opt_fn[idx](idx, NULL, 0);
+		}
+		else {	err = 0; }
+		if ( err != 0 ){
+			return f_env_name[i];
+		}
+	}
+	return NULL;
+}
+
 /* ======================================================================== */
 
 /* on success: prints program help, than exits with status EXIT_FAILURE
@@ -158,46 +317,277 @@ opt_g_apetag_strtol(
 /*@modifies	g_apetag@*/
 {
 	const unsigned int opt_base = OPT_G_APETAG_STRTOL_START;
-	/* * */
-	long value;
-	char *endptr;
-	size_t size_read;
 
 	assert((opt_idx >= OPT_G_APETAG_STRTOL_START)
 	      &&
 	       (opt_idx <= OPT_G_APETAG_STRTOL_END)
 	);
 
+	return opt_strtou32(
+		&((uint32_t *) &g_apetag)[opt_idx - opt_base], arg, arg_len,
+		true
+	);
+}
+
+/* returns 0 on success */
+static int
+opt_g_open_strtol(
+	const unsigned int opt_idx,
+	/*@null@*/ const char *const arg, const size_t arg_len
+)
+/*@globals	g_open@*/
+/*@modifies	g_open@*/
+{
+	const unsigned int opt_base = OPT_G_OPEN_STRTOL_START;
+	/* * */
+	uint32_t value;
+	int err;
+
+	assert((opt_idx >= OPT_G_OPEN_STRTOL_START)
+	      &&
+	       (opt_idx <= OPT_G_OPEN_STRTOL_END)
+	);
+
+	/* --window=0 means no limit, but 0 jobs or a 0 byte tail read make no
+	     sense (and a "no limit" tail would read up to 4 GiB per file)
+	*/
+	err = opt_strtou32(
+		&value, arg, arg_len, (opt_idx == OPT_G_OPEN_WINDOW)
+	);
+	if ( (err != 0) || (value == 0) ){
+		return -1;
+	}
+	((uint32_t *) &g_open)[opt_idx - opt_base] = value;
+
+	return 0;
+}
+
+/* returns 0 on success */
+static int
+opt_g_open_flag(
+	const unsigned int opt_idx,
+	/*@null@*/ const char *const arg, /*@unused@*/ const size_t arg_len
+)
+/*@globals	g_open@*/
+/*@modifies	g_open@*/
+{
+	const unsigned int opt_base = OPT_G_OPEN_FLAG_START;
+
+	/*@-noeffect@*/
+	(void) arg_len;
+	/*@=noeffect@*/
+
+	assert((opt_idx >= OPT_G_OPEN_FLAG_START)
+	      &&
+	       (opt_idx <= OPT_G_OPEN_FLAG_END)
+	);
+
+	if ( arg != NULL ){
+		return -1;
+	}
+	(&g_open.io_uring)[opt_idx - opt_base] = true;
+
+	return 0;
+}
+
+/* returns 0 on success */
+static int
+opt_g_apetag_pad(
+	const unsigned int opt_idx,
+	/*@null@*/ const char *const arg, const size_t arg_len
+)
+/*@globals	g_apetag@*/
+/*@modifies	g_apetag@*/
+{
+	const unsigned int opt_base = OPT_G_APETAG_PAD_START;
+
+	assert((opt_idx >= OPT_G_APETAG_PAD_START)
+	      &&
+	       (opt_idx <= OPT_G_APETAG_PAD_END)
+	);
+
+	return opt_strtou32(
+		&(&g_apetag.pad_size)[opt_idx - opt_base], arg, arg_len, false
+	);
+}
+
+/* --journal takes a path, and --recover takes no argument */
+/* returns 0 on success */
+static int
+opt_g_journal(
+	const unsigned int opt_idx,
+	/*@null@*/ const char *const arg, const size_t arg_len
+)
+/*@globals	g_journal@*/
+/*@modifies	g_journal@*/
+{
+	assert((opt_idx >= OPT_G_JOURNAL_START)
+	      &&
+	       (opt_idx <= OPT_G_JOURNAL_END)
+	);
+
+	if ( opt_idx == OPT_G_JOURNAL_START ){
+		if ( (arg == NULL) || (arg_len == 0) ){
+			return -1;
+		}
+		g_journal.path = arg;
+	}
+	else {	if ( arg != NULL ){
+			return -1;
+		}
+		g_journal.recover = true;
+	}
+	return 0;
+}
+
+/* returns 0 on success */
+static int
+opt_g_apetag_sync(
+	/*@unused@*/ const unsigned int opt_idx,
+	/*@null@*/ const char *const arg, const size_t arg_len
+)
+/*@globals	g_apetag@*/
+/*@modifies	g_apetag@*/
+{
+	/*@-noeffect@*/
+	(void) opt_idx;
+	/*@=noeffect@*/
+
+	if ( arg == NULL ){
+		return -1;
+	}
+	if ( (arg_len == 4u) && (memcmp(arg, "none", arg_len) == 0) ){
+		g_apetag.sync = WRITESYNC_NONE;
+	}
+	else if ( (arg_len == 5u) && (memcmp(arg, "batch", arg_len) == 0) ){
+		g_apetag.sync = WRITESYNC_BATCH;
+	}
+	else if ( (arg_len == 4u) && (memcmp(arg, "file", arg_len) == 0) ){
+		g_apetag.sync = WRITESYNC_FILE;
+	}
+	else {	return -1; }
+
+	return 0;
+}
+
+/* returns 0 on success */
+static int
+opt_g_stats(
+	/*@unused@*/ const unsigned int opt_idx,
+	/*@null@*/ const char *const arg, /*@unused@*/ const size_t arg_len
+)
+/*@globals	internalState,
+		g_stats
+@*/
+/*@modifies	internalState,
+		g_stats
+@*/
+{
+	/*@-noeffect@*/
+	(void) opt_idx;
+	(void) arg_len;
+	/*@=noeffect@*/
+
+	if ( arg != NULL ){
+		return -1;
+	}
+	if ( g_stats.enabled ){
+		return 0;
+	}
+
+	/* registered after gatepa_alloc_destroy(), so it runs before it */
+	if ( atexit(stats_print) != 0 ){
+		return -1;
+	}
+	g_stats.enabled = true;
+
+	return 0;
+}
+
+/* --arena-block takes a power of 2, and --hugepages takes no argument */
+/* returns 0 on success */
+static int
+opt_g_alloc(
+	const unsigned int opt_idx,
+	/*@null@*/ const char *const arg, const size_t arg_len
+)
+/*@globals	g_alloc@*/
+/*@modifies	g_alloc@*/
+{
+	uint32_t value;
+	int err;
+
+	assert((opt_idx >= OPT_G_ALLOC_START)
+	      &&
+	       (opt_idx <= OPT_G_ALLOC_END)
+	);
+
+	if ( opt_idx == OPT_G_ALLOC_START ){
+		err = opt_strtou32(&value, arg, arg_len, false);
+		if ( (err != 0)
+		    ||
+		     (value < ALLOC_BLOCK_SIZE_MIN)
+		    ||
+		     (value > ALLOC_BLOCK_SIZE_MAX)
+		    ||
+		     ((value & (value - 1u)) != 0)
+		){
+			return -1;
+		}
+		g_alloc.block_size = value;
+	}
+	else {	if ( arg != NULL ){
+			return -1;
+		}
+		g_alloc.hugepages = true;
+	}
+	return 0;
+}
+
+/* if zero_is_max, a value of 0 means no limit (UINT32_MAX) */
+/* returns 0 on success */
+static int
+opt_strtou32(
+	/*@out@*/ uint32_t *const value_out,
+	/*@null@*/ const char *const arg, const size_t arg_len,
+	const bool zero_is_max
+)
+/*@modifies	*value_out@*/
+{
+	long value;
+	char *endptr;
+	size_t size_read;
+
 	/* read value */
 	if ( (arg == NULL) || (arg_len == 0) ){
-		/*@-mustmod@*/
+		/*@-mustdefine@*/ /*@-mustmod@*/
 		return -1;
-		/*@=mustmod@*/
+		/*@=mustdefine@*/ /*@=mustmod@*/
 	}
 	errno = 0;
 	value = strtol(arg, &endptr, 10);
 	if ( errno != 0 ){
-		/*@-mustmod@*/
+		/*@-mustdefine@*/ /*@-mustmod@*/
 		return -1;
-		/*@=mustmod@*/
+		/*@=mustdefine@*/ /*@=mustmod@*/
 	}
 	if ( (value < 0) || (value > (long) UINT32_MAX) ){
-		/*@-mustmod@*/
+		/*@-mustdefine@*/ /*@-mustmod@*/
 		return -1;
-		/*@=mustmod@*/
+		/*@=mustdefine@*/ /*@=mustmod@*/
 	}
 	size_read = (size_t) (((uintptr_t) endptr) - ((uintptr_t) arg));
 	if ( size_read != arg_len ){
-		/*@-mustmod@*/
+		/*@-mustdefine@*/ /*@-mustmod@*/
 		return -1;
-		/*@=mustmod@*/
+		/*@=mustdefine@*/ /*@=mustmod@*/
 	}
 
 	/* set value */
-	if ( value == 0 ){
+	if ( (value == 0) && zero_is_max ){
 		value = UINT32_MAX;
 	}
-	((uint32_t *) &g_apetag)[opt_idx - opt_base] = (uint32_t) value;
+	*value_out = (uint32_t) value;
 
 	return 0;
 }
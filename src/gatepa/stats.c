@@ -0,0 +1,167 @@
+/* ///////////////////////////////////////////////////////////////////////////
+//                                                                          //
+// stats.c                                                                  //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+// Copyright (C) 2025, Shane Seelig                                         //
+// SPDX-License-Identifier: GPL-3.0-or-later                                //
+//                                                                          //
+/////////////////////////////////////////////////////////////////////////// */
+
+#include <assert.h>
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <time.h>
+
+#include <libs/nbufio.h>
+
+#include "alloc.h"
+#include "attributes.h"
+#include "mode.h"
+#include "stats.h"
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+/*@checkmod@*/
+struct Stats_Globals g_stats = {
+	.enabled	= false
+};
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+/* open, close, the runs of tag edits ("edit"), and each other mode */
+#define STATS_PHASE_NMEMB_MAX	(3u + GATEPA_NUM_MODES)
+
+struct Stats_Phase {
+	/*@observer@*/ /*@null@*/
+	const char	*name;
+	uint64_t	nsec;
+	uint32_t	count;
+};
+
+/* the phases are only timed from the main thread, in the order first seen */
+/*@unchecked@*/
+static struct Stats_Phase f_phase[STATS_PHASE_NMEMB_MAX];
+/*@unchecked@*/
+static unsigned int       f_phase_nmemb = 0;
+
+/* ------------------------------------------------------------------------ */
+
+/*@unchecked@*/ /*@observer@*/
+static const char *const f_call_name[NBUFIO_CALL_NUM] = {
+	"open",
+	"close",
+	"lock",
+	"seek",
+	"read",
+	"write",
+	"truncate",
+	"sync",
+	"ring"
+};
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+/* returns the monotonic time in nanoseconds, or 0 without --stats */
+GATEPA uint64_t
+stats_clock(void)
+/*@globals	internalState,
+		g_stats
+@*/
+/*@modifies	internalState@*/
+{
+	struct timespec ts;
+
+	if ( !g_stats.enabled ){
+		return 0;
+	}
+	if ( clock_gettime(CLOCK_MONOTONIC, &ts) != 0 ){
+		return 0;
+	}
+	return (((uint64_t) ts.tv_sec) * UINT64_C(1000000000)
+		+ (uint64_t) ts.tv_nsec
+	);
+}
+
+/* adds the time since nsec_begin (from stats_clock()) to the phase */
+GATEPA void
+stats_phase_add(
+	/*@observer@*/ const char *const name, const uint64_t nsec_begin
+)
+/*@globals	internalState,
+		g_stats
+@*/
+/*@modifies	internalState@*/
+{
+	const uint64_t nsec_end = stats_clock();
+	unsigned int i;
+
+	if ( !g_stats.enabled ){
+		return;
+	}
+
+	for ( i = 0; i < f_phase_nmemb; ++i ){
+		if ( f_phase[i].name == name ){
+			break;
+		}
+	}
+	if ( i == f_phase_nmemb ){
+		if ( f_phase_nmemb == STATS_PHASE_NMEMB_MAX ){
+			return;
+		}
+		f_phase[i] = (struct Stats_Phase) {name, 0, 0};
+		f_phase_nmemb += 1u;
+	}
+
+	f_phase[i].nsec  += (nsec_end > nsec_begin ? nsec_end - nsec_begin : 0);
+	f_phase[i].count += 1u;
+	return;
+}
+
+/* ------------------------------------------------------------------------ */
+
+COLD
+GATEPA void
+stats_print(void)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem@*/
+{
+	FILE *const file = stderr;
+	unsigned int i;
+
+	/* phases */
+	(void) fprintf(file, "%-16s %10s %14s\n", "phase", "runs", "msec");
+	for ( i = 0; i < f_phase_nmemb; ++i ){
+		assert(f_phase[i].name != NULL);
+		(void) fprintf(file, "%-16s %10"PRIu32" %10"PRIu64".%03u\n",
+			f_phase[i].name, f_phase[i].count,
+			f_phase[i].nsec / UINT64_C(1000000),
+			(unsigned int) (
+				(f_phase[i].nsec / UINT64_C(1000)) % 1000u
+			)
+		);
+	}
+	(void) fputc('\n', file);
+
+	/* arenas */
+	gatepa_alloc_stats_print(file);
+	(void) fputc('\n', file);
+
+	/* syscalls */
+	(void) fprintf(file, "%-16s %10s\n", "syscall", "count");
+	for ( i = 0; i < NBUFIO_CALL_NUM; ++i ){
+		(void) fprintf(file, "%-16s %10lu\n",
+			f_call_name[i], atomic_load_explicit(
+				&nbufio_ncalls[i], memory_order_relaxed
+			)
+		);
+	}
+	return;
+}
+
+/* EOF //////////////////////////////////////////////////////////////////// */
@@ -0,0 +1,62 @@
+#ifndef GATEPA_STATS_H
+#define GATEPA_STATS_H
+/* ///////////////////////////////////////////////////////////////////////////
+//                                                                          //
+// stats.h - arena, timing, and syscall report (--stats)                    //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+// Copyright (C) 2025, Shane Seelig                                         //
+// SPDX-License-Identifier: GPL-3.0-or-later                                //
+//                                                                          //
+/////////////////////////////////////////////////////////////////////////// */
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "attributes.h"
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+struct Stats_Globals {
+	bool		enabled;	/* print the report at exit         */
+};
+
+/*@checkmod@*/ /*@unused@*/
+extern struct Stats_Globals g_stats;
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+/* a phase is timed like:
+	t = stats_clock();
+	...
+	stats_phase_add(name, t);
+   where name is a string that outlives the report (it is kept, not copied);
+   both do nothing without --stats
+*/
+
+GATEPA_EXTERN uint64_t stats_clock(void)
+/*@globals	internalState,
+		g_stats
+@*/
+/*@modifies	internalState@*/
+;
+
+GATEPA_EXTERN void stats_phase_add(/*@observer@*/ const char *, uint64_t)
+/*@globals	internalState,
+		g_stats
+@*/
+/*@modifies	internalState@*/
+;
+
+/* for atexit() */
+COLD
+GATEPA_EXTERN void stats_print(void)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem@*/
+;
+
+/* EOF //////////////////////////////////////////////////////////////////// */
+#endif	/* GATEPA_STATS_H */
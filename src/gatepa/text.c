@@ -19,6 +19,7 @@
 #include <libs/ascii-literals.h>
 
 #include "attributes.h"
+#include "utility.h"
 
 /* //////////////////////////////////////////////////////////////////////// */
 
@@ -80,6 +81,23 @@ static const uint8_t utf8_cpsize_table[256u] = {
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+/* returns the word with each ascii lowercase byte toupper'd */
+CONST
+ALWAYS_INLINE uint64_t
+swar_toupper(const uint64_t w)
+/*@*/
+{
+	/* 7-bit halves can not carry into the next byte */
+	const uint64_t h     = w & ~SWAR_HIGHBITS;
+	const uint64_t ge_a  = h + SWAR_BYTES(0x80u - ASCII_A_LO);
+	const uint64_t gt_z  = h + SWAR_BYTES(0x7Fu - ASCII_Z_LO);
+	const uint64_t is_lo = ge_a & ~gt_z & ~w & SWAR_HIGHBITS;
+
+	return w - (is_lo >> 2u);
+}
+
+/* ======================================================================== */
+
 /* returns the toupper'd character */
 CONST
 GATEPA uint8_t
@@ -112,10 +130,19 @@ GATEPA int
 ascii_isprintables(const uint8_t *const str, const size_t len)
 /*@*/
 {
+	uint64_t w;
 	uint8_t c;
 	size_t i;
 
-	for ( i = 0; i < len; ++i ){
+	for ( i = 0; len - i >= SWAR_SIZE; i += SWAR_SIZE ){
+		w = swar_load(&str[i]);
+		if ( (SWAR_HASLESS(w, ASCII_SP) | SWAR_HASMORE(w, ASCII_TILDE))
+		    != 0
+		){
+			return -1;
+		}
+	}
+	for ( ; i < len; ++i ){
 		c = str[i];
 		if ( (c < ASCII_SP) || (c > ASCII_TILDE) ){
 			return -1;
@@ -135,7 +162,16 @@ ascii_casecmp(
 	uint8_t c1, c2;
 	size_t i;
 
-	for ( i = 0; i < n; ++i ){
+	/* skip the words that match, the first mismatch is found below */
+	for ( i = 0; n - i >= SWAR_SIZE; i += SWAR_SIZE ){
+		if ( swar_toupper(swar_load(&s1[i]))
+		    !=
+		     swar_toupper(swar_load(&s2[i]))
+		){
+			break;
+		}
+	}
+	for ( ; i < n; ++i ){
 		c1 = ascii_toupper(s1[i]);
 		c2 = ascii_toupper(s2[i]);
 		if ( c1 != c2 ){
@@ -157,6 +193,14 @@ utf8_verify(const uint8_t *const str, const size_t len)
 	size_t i;
 
 	for ( i = 0; i < len; i += cpsize ){
+		/* skip runs of ascii a word at a time */
+		if ( (len - i >= SWAR_SIZE)
+		    &&
+		     ((swar_load(&str[i]) & SWAR_HIGHBITS) == 0)
+		){
+			cpsize = (uint8_t) SWAR_SIZE;
+			continue;
+		}
 		cpsize = utf8_cpsize_table[str[i]];
 		if ( len - i < cpsize ){
 			return -1;
@@ -13,9 +13,50 @@
 
 #include <stddef.h>
 #include <stdint.h>
+#include <string.h>
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+/* for working on strings a word (8 bytes) at a time
+     (SWAR, "SIMD within a register")
+*/
+#define SWAR_SIZE		((size_t) 8u)
+#define SWAR_BYTES(x_byte)	( \
+	UINT64_C(0x0101010101010101) * (uint64_t) (x_byte) \
+)
+#define SWAR_HIGHBITS		SWAR_BYTES(0x80u)
+
+/* any byte < x_n, for x_n <= 0x80 */
+#define SWAR_HASLESS(x_w, x_n)	( \
+	((x_w) - SWAR_BYTES(x_n)) & ~(x_w) & SWAR_HIGHBITS \
+)
+/* any byte > x_n, for x_n <= 0x7F */
+#define SWAR_HASMORE(x_w, x_n)	( \
+	(((x_w) + SWAR_BYTES(0x7Fu - (x_n))) | (x_w)) & SWAR_HIGHBITS \
+)
+/* the high bit of each zero byte, and nothing else */
+#define SWAR_ZEROS(x_w)		( \
+	~((((x_w) & ~SWAR_HIGHBITS) + ~SWAR_HIGHBITS) | (x_w) \
+	  | ~SWAR_HIGHBITS \
+	) \
+)
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+/* returns the (unaligned) word at 'str' */
+PURE
+ALWAYS_INLINE uint64_t
+swar_load(const uint8_t *const str)
+/*@*/
+{
+	uint64_t retval;
+
+	(void) memcpy(&retval, str, sizeof retval);
+	return retval;
+}
+
+/* ======================================================================== */
+
 /* returns the address of the last occurence of 'c', or NULL if no 'c' */
 /*@temp@*/ /*@null@*/
 PURE
@@ -22,15 +22,30 @@ struct Chump_Config {
 	uint32_t	block_size;
 	uint32_t	big_alloc_min;
 	uint32_t	block_full_margin;
-	uint16_t	block_align;
+	uint32_t	block_align;
 	uint16_t	ptr_align;
+	uint16_t	flags;		/* CHUMP_FLAG_* */
 };
 
+/* madvise() each block for transparent hugepages (where supported); the
+     blocks should be a hugepage in size and alignment for it to matter
+*/
+#define CHUMP_FLAG_HUGEPAGE	((uint16_t) 0x0001u)
+
 struct Chump_Stats {
 	uint32_t	nmemb_open;
 	uint32_t	nmemb_full;
 	uint32_t	nmemb_big;
 	uint32_t	num_allocs;	/* saturates */
+	uint64_t	nbytes_big;	/* held by the big allocs   */
+
+	/* since chump_init(), not cleared by chump_reset() */
+	uint64_t	total_asked;	/* bytes (size * nmemb)     */
+	uint64_t	total_given;	/* bytes, after aligning    */
+	uint64_t	total_waste;	/* bytes left in full blocks */
+	uint64_t	total_peak;	/* bytes held (blocks + big) */
+	uint32_t	total_allocs;	/* saturates */
+	uint32_t	total_big;	/* saturates */
 };
 
 struct Chump {
@@ -39,25 +54,36 @@ struct Chump {
 	const struct Chump_Config	config;
 };
 
+/* a checkpoint from chump_mark() */
+struct Chump_Mark {
+	const x_gstring_void_onrd	x_0[2u];
+	const uint32_t			x_1[4u];
+	const uint64_t			x_2;
+};
+
 /* ======================================================================== */
 
 #define CHUMP_CONFIG_STATIC_INIT( \
 	x_block_size, x_big_alloc_min, x_block_full_margin, \
-	x_block_align, x_ptr_align \
+	x_block_align, x_ptr_align, x_flags \
 ) { \
 	(x_block_size), (x_big_alloc_min), (x_block_full_margin), \
-	(x_block_align), (x_ptr_align) \
+	(x_block_align), (x_ptr_align), (x_flags) \
 }
 
 /* ------------------------------------------------------------------------ */
 
 #define CHUMP_STATIC_INIT_NULL		{ \
-	{NULL, NULL, NULL, NULL}, {0,0,0,0}, {0,0,0,0,0} \
+	{NULL, NULL, NULL, NULL}, {0,0,0,0,0,0,0,0,0,0,0}, {0,0,0,0,0,0} \
+}
+
+#define CHUMP_MARK_STATIC_INIT_NULL	{ \
+	{NULL, NULL}, {0,0,0,0}, 0 \
 }
 
 /* !!! config must be valid, or UB !!! */
 #define CHUMP_STATIC_INIT(x_config)	{ \
-	{NULL, NULL, NULL, NULL}, {0,0,0,0}, x_config \
+	{NULL, NULL, NULL, NULL}, {0,0,0,0,0,0,0,0,0,0,0}, x_config \
 }
 
 /* //////////////////////////////////////////////////////////////////////// */
@@ -103,5 +129,71 @@ extern void *chump_alloc(struct Chump *chump, uint32_t size, uint32_t nmemb)
 @*/
 ;
 
+/* ------------------------------------------------------------------------ */
+
+/* a mark stays valid until chump_mark_fini(), so long as the arena is not
+     chump_reset() or chump_destroy()'d in the meantime
+*/
+
+#undef mark
+#undef chump
+/*@external@*/ /*@unused@*/
+extern int chump_mark(
+	/*@out@*/ struct Chump_Mark *mark, const struct Chump *chump
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*mark
+@*/
+;
+
+#undef mark
+/*@external@*/ /*@unused@*/
+extern void chump_mark_fini(struct Chump_Mark *mark)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*mark
+@*/
+/*@releases	mark->x_0[]@*/
+;
+
+#undef chump
+#undef mark
+#undef blocks_kept_max
+/*@external@*/ /*@unused@*/
+extern int chump_rollback(
+	struct Chump *chump, const struct Chump_Mark *mark,
+	uint32_t blocks_kept_max
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*chump
+@*/
+;
+
+/* ------------------------------------------------------------------------ */
+
+#undef dst
+#undef src
+/*@external@*/ /*@unused@*/
+extern int chump_adopt(struct Chump *dst, struct Chump *src)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*dst,
+		*src
+@*/
+;
+
+#undef dst
+#undef src
+/*@external@*/ /*@unused@*/
+extern int chump_give(struct Chump *dst, struct Chump *src, uint32_t)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*dst,
+		*src
+@*/
+;
+
 /* EOF //////////////////////////////////////////////////////////////////// */
 #endif	/* CHUMP_H */
@@ -17,7 +17,7 @@
 /* //////////////////////////////////////////////////////////////////////// */
 
 #define CHUMP_INIT(x_config)	(struct Chump) { \
-	NULL, NULL, NULL, NULL, {0,0,0,0}, x_config \
+	NULL, NULL, NULL, NULL, {0,0,0,0,0,0,0,0,0,0,0}, x_config \
 }
 
 /* //////////////////////////////////////////////////////////////////////// */
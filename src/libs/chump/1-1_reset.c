@@ -31,7 +31,7 @@ static int reset_open(struct Chump *chump, uint32_t)
 ;
 
 #undef chump
-static void reset_open_nbytes_avail(struct Chump *chump, uint32_t)
+static void reset_open_nbytes_avail(struct Chump *chump)
 /*@globals	internalState@*/
 /*@modifies	internalState,
 		*chump
@@ -110,7 +110,7 @@ chump_reset(struct Chump *const chump, const uint32_t blocks_kept_max)
 		if ( err != 0 ){
 			return err;
 		}
-		reset_open_nbytes_avail(chump, blocks_kept);
+		reset_open_nbytes_avail(chump);
 	}
 
 	/* full */
@@ -126,6 +126,7 @@ chump_reset(struct Chump *const chump, const uint32_t blocks_kept_max)
 			&chump->big, &chump->stats.nmemb_big, 0
 		);
 	}
+	chump->stats.nbytes_big	= 0;
 
 	chump->stats.num_allocs	= 0;
 	return 0;
@@ -164,7 +165,7 @@ reset_open(struct Chump *const chump, const uint32_t blocks_kept)
 }
 
 static void
-reset_open_nbytes_avail(struct Chump *const chump, const uint32_t blocks_kept)
+reset_open_nbytes_avail(struct Chump *const chump)
 /*@globals	internalState@*/
 /*@modifies	internalState,
 		*chump
@@ -172,13 +173,14 @@ reset_open_nbytes_avail(struct Chump *const chump, const uint32_t blocks_kept)
 {
 	uint32_t i;
 
-	if ( blocks_kept < chump->stats.nmemb_open ){
-		reset_realloc_array(
-			(void_onlynullptr *) &chump->open_nbytes_avail,
-			&chump->stats.nmemb_open,
-			(uint32_t) (sizeof chump->open_nbytes_avail[0])
-		);
-	}
+	/* resized to reset_open()'s 'stats.nmemb_open', which can be more than
+	     before if blocks were moved from full
+	*/
+	reset_realloc_array(
+		(void_onlynullptr *) &chump->open_nbytes_avail,
+		&chump->stats.nmemb_open,
+		(uint32_t) (sizeof chump->open_nbytes_avail[0])
+	);
 	if ( chump->open_nbytes_avail != NULL ){
 		/* reset the array values to 'empty' */
 		for ( i = 0; i < chump->stats.nmemb_open; ++i ){
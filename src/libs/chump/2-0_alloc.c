@@ -14,6 +14,8 @@
 #include <stdlib.h>
 #include <string.h>
 
+#include <sys/mman.h>
+
 #include "common.h"
 
 /* //////////////////////////////////////////////////////////////////////// */
@@ -58,10 +60,15 @@ static void *alloc_big(struct Chump *chump, uint32_t)
 /*@modifies	internalState,
 		chump->big,
 		chump->big[],
-		chump->stats.nmemb_big
+		chump->stats
 @*/
 ;
 
+#undef chump
+static void alloc_update_peak(struct Chump *chump)
+/*@modifies	chump->stats.total_peak@*/
+;
+
 /* ------------------------------------------------------------------------ */
 
 #undef chump
@@ -113,11 +120,13 @@ chump_alloc(struct Chump *const chump, uint32_t size, const uint32_t nmemb)
 @*/
 {
 	void *retval;
+	uint32_t size_asked;
 	int err_add, err_mul;
 
 	/* align the requested size for aligned_alloc() */
-	err_add = mul_u32_overflow(&size, size, nmemb);
-	size    = ALIGN_BACKWARDS(size, chump->config.ptr_align);
+	err_add    = mul_u32_overflow(&size, size, nmemb);
+	size_asked = size;
+	size       = ALIGN_BACKWARDS(size, chump->config.ptr_align);
 	err_mul = add_u32_overflow(
 		&size, size, (uint32_t) chump->config.ptr_align
 	);
@@ -130,9 +139,18 @@ chump_alloc(struct Chump *const chump, uint32_t size, const uint32_t nmemb)
 		: alloc_big(chump, size)
 	);
 
+	if ( retval == NULL ){
+		return NULL;
+	}
+
 	if ( chump->stats.num_allocs != UINT32_MAX ){
-		chump->stats.num_allocs += (uint8_t) (retval != NULL);
+		chump->stats.num_allocs   += 1u;
+	}
+	if ( chump->stats.total_allocs != UINT32_MAX ){
+		chump->stats.total_allocs += 1u;
 	}
+	chump->stats.total_asked += size_asked;
+	chump->stats.total_given += size;
 
 	return retval;
 }
@@ -195,7 +213,8 @@ alloc_small_old(
 	if ( (nbytes_avail >= chump->config.block_full_margin) ){
 		chump->open_nbytes_avail[idx] = nbytes_avail;
 	}
-	else {	err = alloc_moveto_full(chump, idx);
+	else {	chump->stats.total_waste += nbytes_avail;
+		err = alloc_moveto_full(chump, idx);
 		if ( err != 0 ){
 			return NULL;
 		}
@@ -217,6 +236,7 @@ alloc_small_new(struct Chump *const chump, const uint32_t size)
 	/*@temp@*/
 	void *retval;
 	void *result_ptr;
+	uint32_t idx;
 	int err;
 
 	assert(popcount_u32((uint32_t) chump->config.block_size)  == 1u);
@@ -243,6 +263,16 @@ alloc_small_new(struct Chump *const chump, const uint32_t size)
 	}
 	retval = result_ptr;
 
+	/* only advice, so a failure is ignored */
+#ifdef MADV_HUGEPAGE
+	if ( (chump->config.flags & CHUMP_FLAG_HUGEPAGE) != 0 ){
+		(void) madvise(
+			result_ptr, (size_t) chump->config.block_size,
+			MADV_HUGEPAGE
+		);
+	}
+#endif
+
 	/* check if the block is already full (very large 'stats.ptr_align'),
 	     then add it to the appropriate array
 	*/
@@ -257,11 +287,18 @@ alloc_small_new(struct Chump *const chump, const uint32_t size)
 	else {	err = alloc_addto_ptrarray(
 			&chump->full, &chump->stats.nmemb_full, result_ptr
 		);
+		if ( err == 0 ){
+			idx = chump->stats.nmemb_open;
+			chump->stats.total_waste += (
+				chump->open_nbytes_avail[idx]
+			);
+		}
 	}
 	if ( err != 0 ){
 		free(retval);
 		return NULL;
 	}
+	alloc_update_peak(chump);
 
 	assert(((uintptr_t) retval) % chump->config.block_align == 0);
 	assert(((uintptr_t) retval) % chump->config.ptr_align   == 0);
@@ -276,7 +313,7 @@ alloc_big(struct Chump *const chump, const uint32_t size)
 /*@modifies	internalState,
 		chump->big,
 		chump->big[],
-		chump->stats.nmemb_big
+		chump->stats
 @*/
 {
 	/*@temp@*/
@@ -302,11 +339,35 @@ alloc_big(struct Chump *const chump, const uint32_t size)
 		free(retval);
 		return NULL;
 	}
+	chump->stats.nbytes_big += size;
+	if ( chump->stats.total_big != UINT32_MAX ){
+		chump->stats.total_big += 1u;
+	}
+	alloc_update_peak(chump);
 
 	assert(((uintptr_t) retval) % chump->config.ptr_align == 0);
 	return retval;
 }
 
+/* the blocks and big allocs held right now, if that's the most yet */
+static void
+alloc_update_peak(struct Chump *const chump)
+/*@modifies	chump->stats.total_peak@*/
+{
+	const uint64_t nbytes_held = (
+		  (uint64_t) chump->config.block_size
+		* ((uint64_t) chump->stats.nmemb_open
+		   + chump->stats.nmemb_full
+		  )
+		+ chump->stats.nbytes_big
+	);
+
+	if ( nbytes_held > chump->stats.total_peak ){
+		chump->stats.total_peak = nbytes_held;
+	}
+	return;
+}
+
 /* ------------------------------------------------------------------------ */
 
 /* returns 0 on success */
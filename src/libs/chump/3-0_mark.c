@@ -0,0 +1,304 @@
+/* ///////////////////////////////////////////////////////////////////////////
+//                                                                          //
+// chump/mark.c                                                             //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+// Copyright (C) 2025, Shane Seelig                                         //
+// SPDX-License-Identifier: GPL-3.0-or-later                                //
+//                                                                          //
+/////////////////////////////////////////////////////////////////////////// */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+#define CHUMP_MARK_INIT	(struct Chump_Mark) { \
+	NULL, NULL, 0, 0, 0, 0, 0 \
+}
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+#undef chump
+static int rollback_movefrom_full(struct Chump *chump, uint32_t)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		chump->open,
+		chump->open[],
+		chump->open_nbytes_avail,
+		chump->stats.nmemb_open,
+		chump->stats.nmemb_full
+@*/
+;
+
+#undef chump
+static void rollback_open(
+	struct Chump *chump, const struct Chump_Mark *, uint32_t
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		chump->open[],
+		chump->open_nbytes_avail[],
+		chump->stats.nmemb_open
+@*/
+;
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+/* copies the open blocks' free space, since allocs after the mark can use
+     (and fill) them; the full and big blocks only ever get appended to
+*/
+/* returns 0 on success */
+/*@unused@*/
+int
+chump_mark(
+	/*@out@*/ struct Chump_Mark *const mark,
+	const struct Chump *const chump
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*mark
+@*/
+{
+	uint32_t size_open, size_avail;
+	int err;
+
+	*mark = CHUMP_MARK_INIT;
+
+	if ( chump->stats.nmemb_open != 0 ){
+		assert(chump->open != NULL);
+		assert(chump->open_nbytes_avail != NULL);
+
+		err  = mul_u32_overflow(
+			&size_open, (uint32_t) (sizeof chump->open[0]),
+			chump->stats.nmemb_open
+		);
+		err |= mul_u32_overflow(
+			&size_avail,
+			(uint32_t) (sizeof chump->open_nbytes_avail[0]),
+			chump->stats.nmemb_open
+		);
+		if ( err != 0 ){
+			return -1;
+		}
+
+		mark->open              = malloc((size_t) size_open);
+		mark->open_nbytes_avail = malloc((size_t) size_avail);
+		if ( (mark->open == NULL)
+		    ||
+		     (mark->open_nbytes_avail == NULL)
+		){
+			free(mark->open);
+			free(mark->open_nbytes_avail);
+			*mark = CHUMP_MARK_INIT;
+			return -1;
+		}
+		(void) memcpy(mark->open, chump->open, (size_t) size_open);
+		(void) memcpy(
+			mark->open_nbytes_avail, chump->open_nbytes_avail,
+			(size_t) size_avail
+		);
+	}
+
+	mark->nmemb_open = chump->stats.nmemb_open;
+	mark->nmemb_full = chump->stats.nmemb_full;
+	mark->nmemb_big  = chump->stats.nmemb_big;
+	mark->num_allocs = chump->stats.num_allocs;
+	mark->nbytes_big = chump->stats.nbytes_big;
+	return 0;
+}
+
+/*@unused@*/
+void
+chump_mark_fini(struct Chump_Mark *const mark)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*mark
+@*/
+/*@releases	mark->open,
+		mark->open_nbytes_avail
+@*/
+{
+	free(mark->open);
+	free(mark->open_nbytes_avail);
+	*mark = CHUMP_MARK_INIT;
+	return;
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* frees everything allocated since the mark; the big allocs are freed, and
+     the blocks are kept for re-use, except for any blocks past the first
+     blocks_kept_max that were not open at the mark (the mark stays valid
+     for another rollback)
+*/
+/* the 'total_*' stats are not rolled back */
+/* returns 0 on success */
+/*@unused@*/
+int
+chump_rollback(
+	struct Chump *const chump, const struct Chump_Mark *const mark,
+	const uint32_t blocks_kept_max
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*chump
+@*/
+{
+	uint32_t i;
+	int err;
+
+	assert(chump->stats.nmemb_full >= mark->nmemb_full);
+	assert(chump->stats.nmemb_big  >= mark->nmemb_big);
+
+	/* full: the blocks filled since the mark go back to open */
+	if ( chump->stats.nmemb_full != mark->nmemb_full ){
+		err = rollback_movefrom_full(
+			chump, chump->stats.nmemb_full - mark->nmemb_full
+		);
+		if ( err != 0 ){
+			return err;
+		}
+	}
+
+	/* open */
+	if ( chump->stats.nmemb_open != 0 ){
+		rollback_open(chump, mark, blocks_kept_max);
+	}
+
+	/* big */
+	for ( i = mark->nmemb_big; i < chump->stats.nmemb_big; ++i ){
+		assert(chump->big != NULL);
+		free(chump->big[i]);
+	}
+	chump->stats.nmemb_big  = mark->nmemb_big;
+	chump->stats.nbytes_big = mark->nbytes_big;
+
+	chump->stats.num_allocs = mark->num_allocs;
+	return 0;
+}
+
+/* returns 0 on success */
+static int
+rollback_movefrom_full(struct Chump *const chump, const uint32_t count)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		chump->open,
+		chump->open[],
+		chump->open_nbytes_avail,
+		chump->stats.nmemb_open,
+		chump->stats.nmemb_full
+@*/
+{
+	void *result_ptr;
+	uint32_t nmemb_new, nmemb_realloc, size_memcpy;
+	int err;
+
+	assert(chump->full != NULL);
+	assert(count != 0);
+
+	/* overflow checks */
+	err = add_u32_overflow(&nmemb_new, chump->stats.nmemb_open, count);
+	if ( err != 0 ){
+		return err;
+	}
+	err = mul_u32_overflow(
+		&size_memcpy, (uint32_t) (sizeof chump->open[0]), count
+	);
+	if ( err != 0 ){
+		return err;
+	}
+	nmemb_realloc = ALIGN_BACKWARDS(nmemb_new, CHUMP_NMEMB_MOD);
+
+	/* resize both open arrays (a bigger open_nbytes_avail is harmless if
+	     the second one fails)
+	*/
+	result_ptr = realloc_addmul_check(
+		chump->open_nbytes_avail,
+		(uint32_t) (sizeof chump->open_nbytes_avail[0]), nmemb_realloc
+	);
+	if ( result_ptr == NULL ){
+		/*@-usereleased@*/
+		return -1;
+		/*@=usereleased@*/
+	}
+	chump->open_nbytes_avail = result_ptr;
+	result_ptr = realloc_addmul_check(
+		chump->open, (uint32_t) (sizeof chump->open[0]), nmemb_realloc
+	);
+	if ( result_ptr == NULL ){
+		/*@-usereleased@*/
+		return -1;
+		/*@=usereleased@*/
+	}
+	chump->open = result_ptr;
+
+	/* move block pointers from chump->full to chump->open */
+	(void) memcpy(
+		&chump->open[chump->stats.nmemb_open],
+		&chump->full[chump->stats.nmemb_full - count],
+		(size_t) size_memcpy
+	);
+	chump->stats.nmemb_open  = nmemb_new;
+	chump->stats.nmemb_full -= count;
+
+	return 0;
+}
+
+/* the blocks that were open at the mark get their old free space back, and
+     the rest are empty, with those past blocks_kept_max freed (the arrays
+     keep their size, which is only ever checked on growth)
+*/
+static void
+rollback_open(
+	struct Chump *const chump, const struct Chump_Mark *const mark,
+	const uint32_t blocks_kept_max
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		chump->open[],
+		chump->open_nbytes_avail[],
+		chump->stats.nmemb_open
+@*/
+{
+	uint32_t nmemb = 0, num_kept = 0;
+	uint32_t i, k;
+
+	assert(chump->open != NULL);
+	assert(chump->open_nbytes_avail != NULL);
+
+	for ( i = 0; i < chump->stats.nmemb_open; ++i ){
+		for ( k = 0; k < mark->nmemb_open; ++k ){
+			assert(mark->open != NULL);
+			if ( chump->open[i] == mark->open[k] ){
+				break;
+			}
+		}
+		if ( k != mark->nmemb_open ){
+			assert(mark->open_nbytes_avail != NULL);
+			chump->open_nbytes_avail[nmemb] = (
+				mark->open_nbytes_avail[k]
+			);
+		}
+		else if ( num_kept < blocks_kept_max ){
+			chump->open_nbytes_avail[nmemb] = (
+				chump->config.block_size
+			);
+			num_kept += 1u;
+		}
+		else {	free(chump->open[i]);
+			continue;
+		}
+		chump->open[nmemb] = chump->open[i];
+		nmemb += 1u;
+	}
+	chump->stats.nmemb_open = nmemb;
+	return;
+}
+
+/* EOF //////////////////////////////////////////////////////////////////// */
@@ -0,0 +1,184 @@
+/* ///////////////////////////////////////////////////////////////////////////
+//                                                                          //
+// chump/adopt.c                                                            //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+// Copyright (C) 2025, Shane Seelig                                         //
+// SPDX-License-Identifier: GPL-3.0-or-later                                //
+//                                                                          //
+/////////////////////////////////////////////////////////////////////////// */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+typedef /*@only@*/ /*@null@*/ void *	void_onlynullptr;
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+#undef array
+static int adopt_resize(void_onlynullptr *array, uint32_t, uint32_t)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*array
+@*/
+;
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+/* moves every block and big alloc of src into dst, which then owns (and
+     frees) them; src is left empty, but keeps its arrays
+*/
+/* the arenas must have the same block size */
+/* the 'total_*' stats stay with src, since they count its allocs */
+/* NOTE: src must not be used by another thread meanwhile */
+/* returns 0 on success, or non-zero with both arenas unchanged */
+/*@unused@*/
+int
+chump_adopt(struct Chump *const dst, struct Chump *const src)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*dst,
+		*src
+@*/
+{
+	uint32_t nmemb;
+	int err = 0;
+
+	if ( dst->config.block_size != src->config.block_size ){
+		return -1;
+	}
+
+	/* overflow checks */
+	err |= add_u32_overflow(
+		&nmemb, dst->stats.nmemb_open, src->stats.nmemb_open
+	);
+	err |= add_u32_overflow(
+		&nmemb, dst->stats.nmemb_full, src->stats.nmemb_full
+	);
+	err |= add_u32_overflow(
+		&nmemb, dst->stats.nmemb_big, src->stats.nmemb_big
+	);
+	if ( err != 0 ){
+		return err;
+	}
+
+	/* resize every dst array first, so nothing can fail after the first
+	     block pointer is moved (bigger arrays are harmless)
+	*/
+	if ( src->stats.nmemb_open != 0 ){
+		nmemb = dst->stats.nmemb_open + src->stats.nmemb_open;
+		err |= adopt_resize(
+			(void_onlynullptr *) &dst->open_nbytes_avail, nmemb,
+			(uint32_t) (sizeof dst->open_nbytes_avail[0])
+		);
+		err |= adopt_resize(
+			(void_onlynullptr *) &dst->open, nmemb,
+			(uint32_t) (sizeof dst->open[0])
+		);
+	}
+	if ( src->stats.nmemb_full != 0 ){
+		nmemb = dst->stats.nmemb_full + src->stats.nmemb_full;
+		err |= adopt_resize(
+			(void_onlynullptr *) &dst->full, nmemb,
+			(uint32_t) (sizeof dst->full[0])
+		);
+	}
+	if ( src->stats.nmemb_big != 0 ){
+		nmemb = dst->stats.nmemb_big + src->stats.nmemb_big;
+		err |= adopt_resize(
+			(void_onlynullptr *) &dst->big, nmemb,
+			(uint32_t) (sizeof dst->big[0])
+		);
+	}
+	if ( err != 0 ){
+		return err;
+	}
+
+	/* move the block pointers */
+	if ( src->stats.nmemb_open != 0 ){
+		assert(dst->open != NULL);
+		assert(dst->open_nbytes_avail != NULL);
+		assert(src->open != NULL);
+		assert(src->open_nbytes_avail != NULL);
+		(void) memcpy(
+			&dst->open_nbytes_avail[dst->stats.nmemb_open],
+			src->open_nbytes_avail,
+			(  src->stats.nmemb_open
+			 * sizeof dst->open_nbytes_avail[0]
+			)
+		);
+		(void) memcpy(
+			&dst->open[dst->stats.nmemb_open], src->open,
+			src->stats.nmemb_open * sizeof dst->open[0]
+		);
+		dst->stats.nmemb_open += src->stats.nmemb_open;
+		src->stats.nmemb_open  = 0;
+	}
+	if ( src->stats.nmemb_full != 0 ){
+		assert(dst->full != NULL);
+		assert(src->full != NULL);
+		(void) memcpy(
+			&dst->full[dst->stats.nmemb_full], src->full,
+			src->stats.nmemb_full * sizeof dst->full[0]
+		);
+		dst->stats.nmemb_full += src->stats.nmemb_full;
+		src->stats.nmemb_full  = 0;
+	}
+	if ( src->stats.nmemb_big != 0 ){
+		assert(dst->big != NULL);
+		assert(src->big != NULL);
+		(void) memcpy(
+			&dst->big[dst->stats.nmemb_big], src->big,
+			src->stats.nmemb_big * sizeof dst->big[0]
+		);
+		dst->stats.nmemb_big += src->stats.nmemb_big;
+		src->stats.nmemb_big  = 0;
+	}
+	dst->stats.nbytes_big += src->stats.nbytes_big;
+	src->stats.nbytes_big  = 0;
+
+	if ( dst->stats.num_allocs <= UINT32_MAX - src->stats.num_allocs ){
+		dst->stats.num_allocs += src->stats.num_allocs;
+	}
+	else {	dst->stats.num_allocs  = UINT32_MAX; }
+	src->stats.num_allocs = 0;
+
+	return 0;
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* resizes the array to fit nmemb */
+/* returns 0 on success */
+static int
+adopt_resize(
+	void_onlynullptr *const array, const uint32_t nmemb,
+	const uint32_t sizeof_array0
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*array
+@*/
+{
+	void *result_ptr;
+
+	result_ptr = realloc_addmul_check(
+		*array, sizeof_array0, ALIGN_BACKWARDS(nmemb, CHUMP_NMEMB_MOD)
+	);
+	if ( result_ptr == NULL ){
+		/*@-usereleased@*/
+		return -1;
+		/*@=usereleased@*/
+	}
+	*array = result_ptr;
+	return 0;
+}
+
+/* EOF //////////////////////////////////////////////////////////////////// */
@@ -0,0 +1,114 @@
+/* ///////////////////////////////////////////////////////////////////////////
+//                                                                          //
+// chump/give.c                                                             //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+// Copyright (C) 2025, Shane Seelig                                         //
+// SPDX-License-Identifier: GPL-3.0-or-later                                //
+//                                                                          //
+/////////////////////////////////////////////////////////////////////////// */
+
+#include <assert.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "common.h"
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+/* moves up to nmemb_max of the empty open blocks of src into dst, for dst to
+     fill instead of allocating new blocks
+*/
+/* the arenas must have the same block size */
+/* the 'total_*' stats stay with src, like chump_adopt() */
+/* NOTE: neither arena may be used by another thread meanwhile */
+/* returns 0 on success, or non-zero with both arenas unchanged */
+/*@unused@*/
+int
+chump_give(
+	struct Chump *const dst, struct Chump *const src,
+	const uint32_t nmemb_max
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*dst,
+		*src
+@*/
+{
+	void *result_ptr;
+	uint32_t count = 0, nmemb, nmemb_realloc;
+	uint32_t i;
+	int err;
+
+	if ( dst->config.block_size != src->config.block_size ){
+		return -1;
+	}
+
+	/* count the empty blocks to move */
+	for ( i = 0; (i < src->stats.nmemb_open) && (count < nmemb_max); ++i ){
+		assert(src->open_nbytes_avail != NULL);
+		count += (uint32_t) (
+			src->open_nbytes_avail[i] == src->config.block_size
+		);
+	}
+	if ( count == 0 ){
+		return 0;
+	}
+
+	/* resize both dst arrays first, so nothing can fail after the first
+	     block pointer is moved (bigger arrays are harmless)
+	*/
+	err = add_u32_overflow(&nmemb, dst->stats.nmemb_open, count);
+	if ( err != 0 ){
+		return err;
+	}
+	nmemb_realloc = ALIGN_BACKWARDS(nmemb, CHUMP_NMEMB_MOD);
+	result_ptr    = realloc_addmul_check(
+		dst->open_nbytes_avail,
+		(uint32_t) (sizeof dst->open_nbytes_avail[0]), nmemb_realloc
+	);
+	if ( result_ptr == NULL ){
+		/*@-usereleased@*/
+		return -1;
+		/*@=usereleased@*/
+	}
+	dst->open_nbytes_avail = result_ptr;
+	result_ptr = realloc_addmul_check(
+		dst->open, (uint32_t) (sizeof dst->open[0]), nmemb_realloc
+	);
+	if ( result_ptr == NULL ){
+		/*@-usereleased@*/
+		return -1;
+		/*@=usereleased@*/
+	}
+	dst->open = result_ptr;
+
+	/* move the block pointers, keeping the rest of src in order */
+	assert(src->open != NULL);
+	assert(src->open_nbytes_avail != NULL);
+	nmemb = 0;
+	for ( i = 0; i < src->stats.nmemb_open; ++i ){
+		if ( (count != 0)
+		    &&
+		     (src->open_nbytes_avail[i] == src->config.block_size)
+		){
+			dst->open[dst->stats.nmemb_open] = src->open[i];
+			dst->open_nbytes_avail[dst->stats.nmemb_open] = (
+				dst->config.block_size
+			);
+			dst->stats.nmemb_open += 1u;
+			count                 -= 1u;
+			continue;
+		}
+		src->open[nmemb]              = src->open[i];
+		src->open_nbytes_avail[nmemb] = src->open_nbytes_avail[i];
+		nmemb += 1u;
+	}
+	src->stats.nmemb_open = nmemb;
+
+	return 0;
+}
+
+/* EOF //////////////////////////////////////////////////////////////////// */
@@ -46,15 +46,30 @@ struct Chump_Config {
 	uint32_t	block_size;
 	uint32_t	big_alloc_min;
 	uint32_t	block_full_margin;
-	uint16_t	block_align;
+	uint32_t	block_align;
 	uint16_t	ptr_align;
+	uint16_t	flags;		/* CHUMP_FLAG_* */
 };
 
+/* madvise() each block for transparent hugepages (where supported); the
+     blocks should be a hugepage in size and alignment for it to matter
+*/
+#define CHUMP_FLAG_HUGEPAGE	((uint16_t) 0x0001u)
+
 struct Chump_Stats {
 	uint32_t	nmemb_open;
 	uint32_t	nmemb_full;
 	uint32_t	nmemb_big;
 	uint32_t	num_allocs;	/* saturates */
+	uint64_t	nbytes_big;	/* held by the big allocs   */
+
+	/* since chump_init(), not cleared by chump_reset() */
+	uint64_t	total_asked;	/* bytes (size * nmemb)     */
+	uint64_t	total_given;	/* bytes, after aligning    */
+	uint64_t	total_waste;	/* bytes left in full blocks */
+	uint64_t	total_peak;	/* bytes held (blocks + big) */
+	uint32_t	total_allocs;	/* saturates */
+	uint32_t	total_big;	/* saturates */
 };
 
 struct Chump {
@@ -71,6 +86,20 @@ struct Chump {
 	struct Chump_Config	config;
 };
 
+/* what was allocated before chump_mark() */
+struct Chump_Mark {
+	/*@only@*/ /*@null@*/ /*@reldef@*/
+	uint8_t			**open;		/* blocks not owned */
+	/*@only@*/ /*@null@*/ /*@reldef@*/
+	uint32_t		*open_nbytes_avail;
+
+	uint32_t		nmemb_open;
+	uint32_t		nmemb_full;
+	uint32_t		nmemb_big;
+	uint32_t		num_allocs;
+	uint64_t		nbytes_big;
+};
+
 /* //////////////////////////////////////////////////////////////////////// */
 
 /*@unused@*/
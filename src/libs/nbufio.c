@@ -19,6 +19,11 @@
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+/*@unchecked@*/ /*@unused@*/
+atomic_ulong nbufio_ncalls[NBUFIO_CALL_NUM];
+
+/* //////////////////////////////////////////////////////////////////////// */
+
 /* returns the number of bytes read on success (0 indicates EOF),
      or NBUFIO_RW_ERROR on error
 */
@@ -38,6 +43,7 @@ nbufio_read(const nbufio_fd fd, /*@out@*/ void *const buf, const size_t count)
 	ssize_t result;
 
 	while ( size_read < count ){
+		X_NBUFIO_COUNT(NBUFIO_CALL_READ);
 		result = read(
 			(int) fd, &buf_u8[size_read], count - size_read
 		);
@@ -77,6 +83,7 @@ nbufio_write(const nbufio_fd fd, const void *const buf, const size_t count)
 	ssize_t result;
 
 	while ( size_writ < count ){
+		X_NBUFIO_COUNT(NBUFIO_CALL_WRITE);
 		result = write(
 			(int) fd, &buf_u8[size_writ], count - size_writ
 		);
@@ -97,4 +104,94 @@ nbufio_write(const nbufio_fd fd, const void *const buf, const size_t count)
 	return size_writ;
 }
 
+/* returns the number of bytes read on success (0 indicates EOF),
+     or NBUFIO_RW_ERROR on error
+*/
+/* NOTE: does not change the file offset */
+/*@unused@*/
+size_t
+nbufio_pread(
+	const nbufio_fd fd, /*@out@*/ void *const buf, const size_t count,
+	const off_t offset
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	internalState,
+		*buf
+@*/
+{
+	uint8_t *const buf_u8 = buf;
+	/* * */
+	size_t  size_read = 0;
+	ssize_t result;
+
+	while ( size_read < count ){
+		X_NBUFIO_COUNT(NBUFIO_CALL_READ);
+		result = pread(
+			(int) fd, &buf_u8[size_read], count - size_read,
+			offset + (off_t) size_read
+		);
+		if ( result > 0 ){
+			size_read += (size_t) result;
+		}
+		else if ( result == 0 ){
+			if ( errno == EAGAIN ){
+				continue;
+			}
+			break;	/* EOF */
+		}
+		else {	assert(result == (ssize_t) NBUFIO_RW_ERROR);
+			return (size_t) result;
+		}
+	}
+	assert(size_read <= count);
+	return size_read;
+}
+
+/* returns the number of bytes written on success,
+     or NBUFIO_RW_ERROR on error
+*/
+/* NOTE: does not change the file offset */
+/*@unused@*/
+size_t
+nbufio_pwrite(
+	const nbufio_fd fd, const void *const buf, const size_t count,
+	const off_t offset
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+{
+	const uint8_t *const buf_u8 = buf;
+	/* * */
+	size_t  size_writ = 0;
+	ssize_t result;
+
+	while ( size_writ < count ){
+		X_NBUFIO_COUNT(NBUFIO_CALL_WRITE);
+		result = pwrite(
+			(int) fd, &buf_u8[size_writ], count - size_writ,
+			offset + (off_t) size_writ
+		);
+		if ( result > 0 ){
+			size_writ += (size_t) result;
+		}
+		else if ( result == 0 ){
+			if ( errno == EAGAIN ){
+				continue;
+			}
+			break;	/* EOF */
+		}
+		else {	assert(result == (ssize_t) NBUFIO_RW_ERROR);
+			return (size_t) result;
+		}
+	}
+	assert(size_writ <= count);
+	return size_writ;
+}
+
 /* EOF //////////////////////////////////////////////////////////////////// */
@@ -12,6 +12,7 @@
 /////////////////////////////////////////////////////////////////////////// */
 
 #include <assert.h>
+#include <stdatomic.h>
 #include <stdint.h>
 
 #include <fcntl.h>
@@ -74,6 +75,75 @@ typedef int			nbufio_fd;
 
 /* //////////////////////////////////////////////////////////////////////// */
 
+/* a positioned read, for nbufio_pread_batch() */
+struct NBufIO_ReadReq {
+	nbufio_fd	fd;
+	off_t		offset;
+	/*@temp@*/ /*@relnull@*/
+	void		*buf;
+	size_t		count;
+	size_t		result;		/* set like nbufio_pread() */
+};
+
+/* an io_uring instance (Linux); members are private */
+struct NBufIO_Ring {
+	int		fd;
+	unsigned int	entries;
+	/*@null@*/ /*@owned@*/
+	void		*x_sq_map;
+	/*@null@*/ /*@owned@*/
+	void		*x_cq_map;
+	/*@null@*/ /*@owned@*/
+	void		*x_sqes;
+	size_t		x_sq_map_size;
+	size_t		x_cq_map_size;
+	size_t		x_sqes_size;
+	/*@null@*/ /*@dependent@*/
+	unsigned int	*x_sq_tail;
+	/*@null@*/ /*@dependent@*/
+	unsigned int	*x_sq_array;
+	/*@null@*/ /*@dependent@*/
+	unsigned int	*x_cq_head;
+	/*@null@*/ /*@dependent@*/
+	unsigned int	*x_cq_tail;
+	/*@null@*/ /*@dependent@*/
+	void		*x_cqes;
+	unsigned int	x_sq_mask;
+	unsigned int	x_cq_mask;
+};
+
+#define NBUFIO_RING_STATIC_INIT_NULL	{ \
+	-1, 0, NULL, NULL, NULL, 0, 0, 0, NULL, NULL, NULL, NULL, NULL, 0, 0 \
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* the syscalls made through nbufio, by kind (a retried read or write counts
+     each try)
+*/
+enum NBufIO_Call {
+	NBUFIO_CALL_OPEN,
+	NBUFIO_CALL_CLOSE,
+	NBUFIO_CALL_LOCK,
+	NBUFIO_CALL_SEEK,
+	NBUFIO_CALL_READ,
+	NBUFIO_CALL_WRITE,
+	NBUFIO_CALL_TRUNCATE,
+	NBUFIO_CALL_SYNC,
+	NBUFIO_CALL_RING
+};
+
+#define NBUFIO_CALL_NUM		9u
+
+/*@unchecked@*/ /*@unused@*/
+extern atomic_ulong nbufio_ncalls[NBUFIO_CALL_NUM];
+
+#define X_NBUFIO_COUNT(x_call)	((void) atomic_fetch_add_explicit( \
+	&nbufio_ncalls[(x_call)], 1ul, memory_order_relaxed \
+))
+
+/* //////////////////////////////////////////////////////////////////////// */
+
 /*@-globuse@*/ /*@-mustmod@*/ /*@+longintegral@*/
 
 /* ======================================================================== */
@@ -99,6 +169,62 @@ extern size_t nbufio_write(nbufio_fd, const void *, size_t)
 @*/
 ;
 
+/*@external@*/ /*@unused@*/
+extern size_t nbufio_pwrite(nbufio_fd, const void *, size_t, off_t)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+;
+
+#undef buf
+/*@external@*/ /*@unused@*/
+extern size_t nbufio_pread(nbufio_fd, /*@out@*/ void *buf, size_t, off_t)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	internalState,
+		*buf
+@*/
+;
+
+/* ------------------------------------------------------------------------ */
+
+#undef ring
+/*@external@*/ /*@unused@*/
+extern int nbufio_ring_init(/*@out@*/ struct NBufIO_Ring *ring, unsigned int)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*ring
+@*/
+;
+
+#undef ring
+/*@external@*/ /*@unused@*/
+extern void nbufio_ring_fini(struct NBufIO_Ring *ring)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*ring
+@*/
+;
+
+#undef ring
+#undef req
+/*@external@*/ /*@unused@*/
+extern int nbufio_pread_batch(
+	/*@null@*/ struct NBufIO_Ring *ring, struct NBufIO_ReadReq *req, size_t
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	internalState,
+		*ring,
+		*req
+@*/
+;
+
 /* //////////////////////////////////////////////////////////////////////// */
 
 /* returns NBUFIO_FD_ERROR on error */
@@ -111,9 +237,26 @@ nbufio_open(const char *const pathname, const int flags)
 @*/
 /*@modifies	internalState@*/
 {
+	X_NBUFIO_COUNT(NBUFIO_CALL_OPEN);
 	return open(pathname, flags);
 }
 
+/* creates the file (with mode) if it doesn't exist */
+/* returns NBUFIO_FD_ERROR on error */
+X_NBUFIO_ALWAYS_INLINE
+nbufio_fd
+nbufio_create(const char *const pathname, const int flags, const mode_t mode)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	fileSystem,
+		internalState
+@*/
+{
+	X_NBUFIO_COUNT(NBUFIO_CALL_OPEN);
+	return open(pathname, flags | O_CREAT, mode);
+}
+
 /* returns 0 on success */
 X_NBUFIO_ALWAYS_INLINE
 int
@@ -123,6 +266,7 @@ nbufio_close(const nbufio_fd fd)
 @*/
 /*@modifies	internalState@*/
 {
+	X_NBUFIO_COUNT(NBUFIO_CALL_CLOSE);
 	return close((int) fd);
 }
 
@@ -150,6 +294,7 @@ nbufio_lock(const nbufio_fd fd, const int operation)
 		internalState
 @*/
 {
+	X_NBUFIO_COUNT(NBUFIO_CALL_LOCK);
 	return flock((int) fd, operation);
 }
 
@@ -162,6 +307,7 @@ nbufio_tell(const nbufio_fd fd)
 /*@globals	internalState@*/
 /*@modifies	nothing@*/
 {
+	X_NBUFIO_COUNT(NBUFIO_CALL_SEEK);
 	return lseek((int) fd, 0, SEEK_CUR);
 }
 
@@ -172,6 +318,7 @@ nbufio_seek(const nbufio_fd fd, const off_t offset, const int whence)
 /*@globals	internalState@*/
 /*@modifies	internalState@*/
 {
+	X_NBUFIO_COUNT(NBUFIO_CALL_SEEK);
 	return lseek((int) fd, offset, whence);
 }
 
@@ -192,11 +339,48 @@ nbufio_truncate(const nbufio_fd fd, const off_t length)
 /*@globals	fileSystem@*/
 /*@modifies	fileSystem@*/
 {
+	X_NBUFIO_COUNT(NBUFIO_CALL_TRUNCATE);
 	return ftruncate((int) fd, length);
 }
 
 /* ======================================================================== */
 
+/* flushes the file's data (and the metadata needed to read it) to disk */
+/* returns 0 on success */
+X_NBUFIO_ALWAYS_INLINE
+int
+nbufio_datasync(const nbufio_fd fd)
+/*@globals	fileSystem@*/
+/*@modifies	fileSystem@*/
+{
+	X_NBUFIO_COUNT(NBUFIO_CALL_SYNC);
+	return fdatasync((int) fd);
+}
+
+/* starts writing back the range (len 0 is to the EOF) without waiting for
+     it, so a later nbufio_datasync() has less to wait on; a no-op where
+     sync_file_range() is unavailable
+*/
+/* returns 0 on success */
+X_NBUFIO_ALWAYS_INLINE
+int
+nbufio_datasync_start(const nbufio_fd fd, const off_t offset, const off_t len)
+/*@globals	fileSystem@*/
+/*@modifies	fileSystem@*/
+{
+#ifdef SYNC_FILE_RANGE_WRITE
+	X_NBUFIO_COUNT(NBUFIO_CALL_SYNC);
+	return sync_file_range((int) fd, offset, len, SYNC_FILE_RANGE_WRITE);
+#else
+	(void) fd;
+	(void) offset;
+	(void) len;
+	return 0;
+#endif
+}
+
+/* ======================================================================== */
+
 /*@=globuse@*/ /*@=mustmod@*/ /*@=longintegral@*/
 
 /* EOF //////////////////////////////////////////////////////////////////// */
@@ -0,0 +1,391 @@
+/* ///////////////////////////////////////////////////////////////////////////
+//                                                                          //
+// nbufio_ring.c - batched positioned reads (io_uring)                      //
+//                                                                          //
+//////////////////////////////////////////////////////////////////////////////
+//                                                                          //
+// Copyright (C) 2025, Shane Seelig                                         //
+// SPDX-License-Identifier: GPL-3.0-or-later                                //
+//                                                                          //
+/////////////////////////////////////////////////////////////////////////// */
+
+#include <assert.h>
+#include <errno.h>
+#include <stdint.h>
+#include <string.h>
+
+#include <unistd.h>
+
+#include "nbufio.h"
+
+#ifdef __linux__
+#include <stdatomic.h>
+
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#endif	/* __linux__ */
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+#ifdef __linux__
+
+#define RING_ATOMIC(x_ptr)	((_Atomic unsigned int *) (x_ptr))
+
+#define RING_SQE(x_ring, x_idx)	\
+	(&((struct io_uring_sqe *) (x_ring)->x_sqes)[(x_idx)])
+#define RING_CQE(x_ring, x_idx)	\
+	(&((struct io_uring_cqe *) (x_ring)->x_cqes)[(x_idx)])
+
+#endif	/* __linux__ */
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+#undef req
+static void pread_batch_sync(struct NBufIO_ReadReq *req, size_t)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	internalState,
+		*req
+@*/
+;
+
+#ifdef __linux__
+
+#undef ring
+#undef req
+static int ring_submit_wait(
+	struct NBufIO_Ring *ring, struct NBufIO_ReadReq *req, unsigned int
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	internalState,
+		*ring,
+		*req
+@*/
+;
+
+#endif	/* __linux__ */
+
+/* //////////////////////////////////////////////////////////////////////// */
+
+/* returns 0 on success */
+/*@unused@*/
+int
+nbufio_ring_init(
+	/*@out@*/ struct NBufIO_Ring *const ring, const unsigned int entries
+)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*ring
+@*/
+{
+#ifdef __linux__
+
+	struct io_uring_params params;
+	uint8_t *sq_map, *cq_map;
+	unsigned int i;
+	long fd;
+
+	*ring = (struct NBufIO_Ring) NBUFIO_RING_STATIC_INIT_NULL;
+
+	(void) memset(&params, 0x00, sizeof params);
+	X_NBUFIO_COUNT(NBUFIO_CALL_RING);
+	fd = syscall(__NR_io_uring_setup, entries, &params);
+	if ( fd < 0 ){
+		return -1;
+	}
+	ring->fd      = (int) fd;
+	ring->entries = params.sq_entries;
+
+	/* map the rings separately, so older kernels work too */
+	ring->x_sq_map_size = (size_t) params.sq_off.array
+		+ params.sq_entries * sizeof(unsigned int)
+	;
+	ring->x_cq_map_size = (size_t) params.cq_off.cqes
+		+ params.cq_entries * sizeof(struct io_uring_cqe)
+	;
+	ring->x_sqes_size = params.sq_entries * sizeof(struct io_uring_sqe);
+
+	ring->x_sq_map = mmap(
+		NULL, ring->x_sq_map_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ring->fd, (off_t) IORING_OFF_SQ_RING
+	);
+	ring->x_cq_map = mmap(
+		NULL, ring->x_cq_map_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ring->fd, (off_t) IORING_OFF_CQ_RING
+	);
+	ring->x_sqes = mmap(
+		NULL, ring->x_sqes_size, PROT_READ | PROT_WRITE,
+		MAP_SHARED | MAP_POPULATE, ring->fd, (off_t) IORING_OFF_SQES
+	);
+	if ( (ring->x_sq_map == MAP_FAILED)
+	    ||
+	     (ring->x_cq_map == MAP_FAILED)
+	    ||
+	     (ring->x_sqes   == MAP_FAILED)
+	){
+		nbufio_ring_fini(ring);
+		return -1;
+	}
+
+	sq_map = ring->x_sq_map;
+	cq_map = ring->x_cq_map;
+	ring->x_sq_tail  = (unsigned int *) &sq_map[params.sq_off.tail];
+	ring->x_sq_array = (unsigned int *) &sq_map[params.sq_off.array];
+	ring->x_sq_mask  = *(unsigned int *) &sq_map[params.sq_off.ring_mask];
+	ring->x_cq_head  = (unsigned int *) &cq_map[params.cq_off.head];
+	ring->x_cq_tail  = (unsigned int *) &cq_map[params.cq_off.tail];
+	ring->x_cqes     = &cq_map[params.cq_off.cqes];
+	ring->x_cq_mask  = *(unsigned int *) &cq_map[params.cq_off.ring_mask];
+
+	/* sqes are always used in ring order */
+	for ( i = 0; i < params.sq_entries; ++i ){
+		ring->x_sq_array[i] = i;
+	}
+	return 0;
+
+#else	/* !defined(__linux__) */
+
+	*ring = (struct NBufIO_Ring) NBUFIO_RING_STATIC_INIT_NULL;
+	(void) entries;
+	return -1;
+
+#endif	/* __linux__ */
+}
+
+/*@unused@*/
+void
+nbufio_ring_fini(struct NBufIO_Ring *const ring)
+/*@globals	internalState@*/
+/*@modifies	internalState,
+		*ring
+@*/
+{
+#ifdef __linux__
+	if ( (ring->x_sq_map != NULL) && (ring->x_sq_map != MAP_FAILED) ){
+		(void) munmap(ring->x_sq_map, ring->x_sq_map_size);
+	}
+	if ( (ring->x_cq_map != NULL) && (ring->x_cq_map != MAP_FAILED) ){
+		(void) munmap(ring->x_cq_map, ring->x_cq_map_size);
+	}
+	if ( (ring->x_sqes   != NULL) && (ring->x_sqes   != MAP_FAILED) ){
+		(void) munmap(ring->x_sqes, ring->x_sqes_size);
+	}
+	if ( ring->fd >= 0 ){
+		(void) close(ring->fd);
+	}
+#endif	/* __linux__ */
+
+	*ring = (struct NBufIO_Ring) NBUFIO_RING_STATIC_INIT_NULL;
+	return;
+}
+
+/* ------------------------------------------------------------------------ */
+
+/* reads every request, submitting as many as the ring holds at once;
+     falls back to nbufio_pread() if ring is NULL or unusable
+*/
+/* each req->result is set like nbufio_pread() */
+/* returns 0 on success, or -1 if the ring failed (and was finalized) */
+/*@unused@*/
+int
+nbufio_pread_batch(
+	/*@null@*/ struct NBufIO_Ring *const ring,
+	struct NBufIO_ReadReq *const req, const size_t nmemb
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	internalState,
+		*ring,
+		*req
+@*/
+{
+#ifdef __linux__
+	size_t i = 0;
+	unsigned int chunk;
+	int err;
+
+	if ( (ring != NULL) && (ring->fd >= 0) ){
+		for ( ; i < nmemb; i += chunk ){
+			chunk = (nmemb - i < (size_t) ring->entries
+				? (unsigned int) (nmemb - i) : ring->entries
+			);
+			err = ring_submit_wait(ring, &req[i], chunk);
+			if ( err != 0 ){
+				nbufio_ring_fini(ring);
+				pread_batch_sync(&req[i], nmemb - i);
+				return -1;
+			}
+		}
+		return 0;
+	}
+#endif	/* __linux__ */
+
+	(void) ring;
+	pread_batch_sync(req, nmemb);
+	return 0;
+}
+
+/* ------------------------------------------------------------------------ */
+
+static void
+pread_batch_sync(struct NBufIO_ReadReq *const req, const size_t nmemb)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	internalState,
+		*req
+@*/
+{
+	size_t i;
+
+	for ( i = 0; i < nmemb; ++i ){
+		req[i].result = nbufio_pread(
+			req[i].fd, req[i].buf, req[i].count, req[i].offset
+		);
+	}
+	return;
+}
+
+#ifdef __linux__
+
+/* short reads are finished synchronously */
+/* returns 0 on success, or -1 if the ring failed or the kernel cannot do
+     IORING_OP_READ (before Linux 5.6), for the caller to redo the reads
+*/
+static int
+ring_submit_wait(
+	struct NBufIO_Ring *const ring, struct NBufIO_ReadReq *const req,
+	const unsigned int nmemb
+)
+/*@globals	fileSystem,
+		internalState
+@*/
+/*@modifies	internalState,
+		*ring,
+		*req
+@*/
+{
+	struct io_uring_sqe *sqe;
+	const struct io_uring_cqe *cqe;
+	unsigned int tail, head;
+	unsigned int num_queued = 0, num_unsubmitted, num_reaped = 0;
+	unsigned int unsupported = 0;
+	unsigned int i;
+	size_t rest;
+	long err;
+
+	assert(nmemb <= ring->entries);
+
+	/* fill the submission queue */
+	tail = *ring->x_sq_tail;
+	for ( i = 0; i < nmemb; ++i ){
+		if ( req[i].count > (size_t) UINT32_MAX ){
+			req[i].result = nbufio_pread(
+				req[i].fd, req[i].buf, req[i].count,
+				req[i].offset
+			);
+			continue;
+		}
+		sqe = RING_SQE(ring, tail & ring->x_sq_mask);
+		(void) memset(sqe, 0x00, sizeof *sqe);
+		sqe->opcode    = (uint8_t) IORING_OP_READ;
+		sqe->fd        = req[i].fd;
+		sqe->off       = (uint64_t) req[i].offset;
+		sqe->addr      = (uint64_t) (uintptr_t) req[i].buf;
+		sqe->len       = (uint32_t) req[i].count;
+		sqe->user_data = (uint64_t) i;
+		tail          += 1u;
+		num_queued    += 1u;
+	}
+	atomic_store_explicit(
+		RING_ATOMIC(ring->x_sq_tail), tail, memory_order_release
+	);
+
+	/* submit + wait */
+	num_unsubmitted = num_queued;
+	while ( num_reaped < num_queued ){
+		X_NBUFIO_COUNT(NBUFIO_CALL_RING);
+		err = syscall(
+			__NR_io_uring_enter, ring->fd, num_unsubmitted, 1u,
+			IORING_ENTER_GETEVENTS, NULL, 0
+		);
+		if ( err < 0 ){
+			if ( errno == EINTR ){
+				continue;
+			}
+			return -1;
+		}
+		num_unsubmitted -= (unsigned int) err;
+
+		head = *ring->x_cq_head;
+		tail = atomic_load_explicit(
+			RING_ATOMIC(ring->x_cq_tail), memory_order_acquire
+		);
+		for ( ; head != tail; ++head ){
+			cqe = RING_CQE(ring, head & ring->x_cq_mask);
+			i   = (unsigned int) cqe->user_data;
+			if ( cqe->res >= 0 ){
+				req[i].result = (size_t) cqe->res;
+			}
+			else if ( (cqe->res == -EAGAIN)
+			         ||
+			          (cqe->res == -EINTR)
+			){
+				req[i].result = 0;
+			}
+			else if ( (cqe->res == -EINVAL)
+			         ||
+			          (cqe->res == -EOPNOTSUPP)
+			){
+				unsupported   = 1u;
+				req[i].result = NBUFIO_RW_ERROR;
+			}
+			else {	errno = -cqe->res;
+				req[i].result = NBUFIO_RW_ERROR;
+			}
+			num_reaped += 1u;
+		}
+		atomic_store_explicit(
+			RING_ATOMIC(ring->x_cq_head), head,
+			memory_order_release
+		);
+
+		/* submit no more, but reap the reads already in flight */
+		if ( unsupported != 0 ){
+			num_queued     -= num_unsubmitted;
+			num_unsubmitted = 0;
+		}
+	}
+
+	if ( unsupported != 0 ){
+		return -1;
+	}
+
+	/* finish any short reads */
+	for ( i = 0; i < nmemb; ++i ){
+		if ( (req[i].result == NBUFIO_RW_ERROR)
+		    ||
+		     (req[i].result >= req[i].count)
+		){
+			continue;
+		}
+		rest = nbufio_pread(
+			req[i].fd, &((uint8_t *) req[i].buf)[req[i].result],
+			req[i].count - req[i].result,
+			req[i].offset + (off_t) req[i].result
+		);
+		req[i].result = (rest != NBUFIO_RW_ERROR
+			? req[i].result + rest : NBUFIO_RW_ERROR
+		);
+	}
+	return 0;
+}
+
+#endif	/* __linux__ */
+
+/* EOF //////////////////////////////////////////////////////////////////// */